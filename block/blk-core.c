@@ -32,6 +32,7 @@
 #include <linux/delay.h>
 #include <linux/ratelimit.h>
 #include <linux/pm_runtime.h>
+#include <linux/hrtimer.h>
 #include <linux/blk-cgroup.h>
 
 #define CREATE_TRACE_POINTS
@@ -720,6 +721,7 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	setup_timer(&q->backing_dev_info.laptop_mode_wb_timer,
 		    laptop_mode_timer_fn, (unsigned long) q);
 	setup_timer(&q->timeout, blk_rq_timed_out_timer, (unsigned long) q);
+	q->poll_nsec = -1;
 	INIT_LIST_HEAD(&q->queue_head);
 	INIT_LIST_HEAD(&q->timeout_list);
 	INIT_LIST_HEAD(&q->icq_list);
@@ -1257,6 +1259,11 @@ retry:
 	if (!IS_ERR(rq))
 		return rq;
 
+	if (op_flags & REQ_NOWAIT) {
+		blk_put_rl(rl);
+		return ERR_PTR(-EAGAIN);
+	}
+
 	if (!gfpflags_allow_blocking(gfp_mask) || unlikely(blk_queue_dying(q))) {
 		blk_put_rl(rl);
 		return rq;
@@ -1730,11 +1737,12 @@ get_rq:
 	/*
 	 * Add in META/PRIO flags, if set, before we get to the IO scheduler
 	 */
-	rw_flags |= (bio->bi_opf & (REQ_META | REQ_PRIO));
+	rw_flags |= (bio->bi_opf & (REQ_META | REQ_PRIO | REQ_NOWAIT));
 
 	/*
-	 * Grab a free request. This is might sleep but can not fail.
-	 * Returns with the queue unlocked.
+	 * Grab a free request. This might sleep, unless REQ_NOWAIT is
+	 * set, in which case a failed allocation ends the bio with
+	 * -EAGAIN below. Returns with the queue unlocked.
 	 */
 	req = get_request(q, bio_data_dir(bio), rw_flags, bio, GFP_NOIO);
 	if (IS_ERR(req)) {
@@ -1929,6 +1937,13 @@ generic_make_request_checks(struct bio *bio)
 		}
 	}
 
+	/*
+	 * For a REQ_NOWAIT based request, return -EOPNOTSUPP
+	 * if queue is not a request based queue.
+	 */
+	if ((bio->bi_opf & REQ_NOWAIT) && !queue_is_rq_based(q))
+		goto not_supported;
+
 	switch (bio_op(bio)) {
 	case REQ_OP_DISCARD:
 		if (!blk_queue_discard(q))
@@ -2034,8 +2049,9 @@ blk_qc_t generic_make_request(struct bio *bio)
 	current->bio_list = &bio_list_on_stack;
 	do {
 		struct request_queue *q = bdev_get_queue(bio->bi_bdev);
+		bool nowait = bio->bi_opf & REQ_NOWAIT;
 
-		if (likely(blk_queue_enter(q, false) == 0)) {
+		if (likely(blk_queue_enter(q, nowait) == 0)) {
 			ret = q->make_request_fn(q, bio);
 
 			blk_queue_exit(q);
@@ -2044,7 +2060,10 @@ blk_qc_t generic_make_request(struct bio *bio)
 		} else {
 			struct bio *bio_next = bio_list_pop(current->bio_list);
 
-			bio_io_error(bio);
+			if (nowait && !blk_queue_dying(q))
+				bio_wouldblock_error(bio);
+			else
+				bio_io_error(bio);
 			bio = bio_next;
 		}
 	} while (bio);
@@ -3303,12 +3322,69 @@ void blk_finish_plug(struct blk_plug *plug)
 }
 EXPORT_SYMBOL(blk_finish_plug);
 
+/*
+ * Hybrid polling: instead of burning the CPU for the whole completion
+ * latency, sleep first for (an estimate of) most of it and only spin
+ * for the remainder.  The sleep duration is either fixed by the
+ * io_poll_delay queue attribute or derived from the mean completion
+ * latency the pollers of this hctx have been seeing.  Returns true if
+ * we slept, in which case the request may well already have completed.
+ */
+static bool blk_poll_hybrid_sleep(struct request_queue *q,
+				  struct blk_mq_hw_ctx *hctx,
+				  struct request *rq)
+{
+	struct hrtimer_sleeper hs;
+	enum hrtimer_mode mode;
+	u64 nsecs;
+
+	if (q->poll_nsec < 0)
+		return false;
+	if (test_bit(REQ_ATOM_POLL_SLEPT, &rq->atomic_flags))
+		return false;
+
+	if (q->poll_nsec > 0)
+		nsecs = q->poll_nsec;
+	else
+		nsecs = hctx->poll_mean_ns >> 1;
+	if (!nsecs)
+		return false;
+
+	/*
+	 * A poller may call in repeatedly for the same request; make
+	 * sure we only sleep once per request.
+	 */
+	set_bit(REQ_ATOM_POLL_SLEPT, &rq->atomic_flags);
+
+	mode = HRTIMER_MODE_REL;
+	hrtimer_init_on_stack(&hs.timer, CLOCK_MONOTONIC, mode);
+	hrtimer_set_expires(&hs.timer, ktime_set(0, nsecs));
+
+	hrtimer_init_sleeper(&hs, current);
+	do {
+		if (test_bit(REQ_ATOM_COMPLETE, &rq->atomic_flags))
+			break;
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		hrtimer_start_expires(&hs.timer, mode);
+		if (hs.task)
+			io_schedule();
+		hrtimer_cancel(&hs.timer);
+		mode = HRTIMER_MODE_ABS;
+	} while (hs.task && !signal_pending(current));
+
+	__set_current_state(TASK_RUNNING);
+	destroy_hrtimer_on_stack(&hs.timer);
+	return true;
+}
+
 bool blk_poll(struct request_queue *q, blk_qc_t cookie)
 {
+	struct blk_mq_hw_ctx *hctx;
 	struct blk_plug *plug;
+	struct request *rq;
+	u64 poll_start;
 	long state;
 	unsigned int queue_num;
-	struct blk_mq_hw_ctx *hctx;
 
 	if (!q->mq_ops || !q->mq_ops->poll || !blk_qc_t_valid(cookie) ||
 	    !test_bit(QUEUE_FLAG_POLL, &q->queue_flags))
@@ -3322,6 +3398,18 @@ bool blk_poll(struct request_queue *q, blk_qc_t cookie)
 	if (plug)
 		blk_flush_plug_list(plug, false);
 
+	/*
+	 * The request may already be gone; blk_mq_tag_to_rq() then
+	 * returns NULL or an unrelated request, in which case we skip
+	 * the sleep and go straight to polling.
+	 */
+	rq = blk_mq_tag_to_rq(hctx->tags, blk_qc_t_to_tag(cookie));
+	if (rq && blk_poll_hybrid_sleep(q, hctx, rq)) {
+		if (test_bit(REQ_ATOM_COMPLETE, &rq->atomic_flags))
+			return true;
+	}
+
+	poll_start = ktime_get_ns();
 	state = current->state;
 	while (!need_resched()) {
 		int ret;
@@ -3330,7 +3418,19 @@ bool blk_poll(struct request_queue *q, blk_qc_t cookie)
 
 		ret = q->mq_ops->poll(hctx, blk_qc_t_to_tag(cookie));
 		if (ret > 0) {
+			u64 mean = hctx->poll_mean_ns;
+			u64 elapsed = ktime_get_ns() - poll_start;
+
 			hctx->poll_success++;
+			/*
+			 * Feed the time we spent waiting into the latency
+			 * estimate used by hybrid sleeping.  This is only
+			 * the tail of the request's life when the poller
+			 * arrives late, so the EWMA under-, never
+			 * over-estimates the completion time.
+			 */
+			hctx->poll_mean_ns = mean ?
+				(3 * mean + elapsed) >> 2 : elapsed;
 			set_current_state(TASK_RUNNING);
 			return true;
 		}
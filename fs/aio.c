@@ -137,6 +137,7 @@ struct kioctx {
 	struct {
 		spinlock_t	ctx_lock;
 		struct list_head active_reqs;	/* used for cancellation */
+		struct list_head poll_reqs;	/* polled (RWF_HIPRI) reqs */
 	} ____cacheline_aligned_in_smp;
 
 	struct {
@@ -180,6 +181,9 @@ struct aio_kiocb {
 
 	struct list_head	ki_list;	/* the aio core uses this
 						 * for cancellation */
+	struct list_head	ki_poll_list;	/* on the ctx poll_reqs list
+						 * for RWF_HIPRI requests */
+	struct request_queue	*ki_poll_q;	/* queue to poll completions */
 
 	/*
 	 * If the aio_resfd field of the userspace iocb is not zero,
@@ -742,6 +746,7 @@ static struct kioctx *ioctx_alloc(unsigned nr_events)
 	init_waitqueue_head(&ctx->wait);
 
 	INIT_LIST_HEAD(&ctx->active_reqs);
+	INIT_LIST_HEAD(&ctx->poll_reqs);
 
 	if (percpu_ref_init(&ctx->users, free_ioctx_users, 0, GFP_KERNEL))
 		goto err;
@@ -1098,11 +1103,14 @@ static void aio_complete(struct kiocb *kiocb, long res, long res2)
 	 */
 	BUG_ON(is_sync_kiocb(kiocb));
 
-	if (iocb->ki_list.next) {
+	if (iocb->ki_list.next || iocb->ki_poll_list.next) {
 		unsigned long flags;
 
 		spin_lock_irqsave(&ctx->ctx_lock, flags);
-		list_del(&iocb->ki_list);
+		if (iocb->ki_list.next)
+			list_del(&iocb->ki_list);
+		if (iocb->ki_poll_list.next)
+			list_del(&iocb->ki_poll_list);
 		spin_unlock_irqrestore(&ctx->ctx_lock, flags);
 	}
 
@@ -1281,6 +1289,48 @@ static bool aio_read_events(struct kioctx *ctx, long min_nr, long nr,
 	return ret < 0 || *i >= min_nr;
 }
 
+#define AIO_POLL_BATCH	8
+
+/*
+ * Poll the block queues of in-flight RWF_HIPRI requests for completions
+ * instead of waiting for their IRQs.  The (queue, cookie) pairs are
+ * snapshotted in small batches under ctx_lock with a queue reference
+ * held, as blk_poll() may spin and must not be called under the lock.
+ * Returns false when there was nothing pollable in flight.
+ */
+static bool aio_poll_requests(struct kioctx *ctx)
+{
+	struct {
+		struct request_queue	*q;
+		blk_qc_t		cookie;
+	} batch[AIO_POLL_BATCH];
+	struct aio_kiocb *req;
+	int nr = 0, i;
+
+	spin_lock_irq(&ctx->ctx_lock);
+	list_for_each_entry(req, &ctx->poll_reqs, ki_poll_list) {
+		blk_qc_t cookie = READ_ONCE(req->common.ki_cookie);
+
+		/* no bio submitted yet */
+		if (!blk_qc_t_valid(cookie))
+			continue;
+		if (!blk_get_queue(req->ki_poll_q))
+			continue;
+		batch[nr].q = req->ki_poll_q;
+		batch[nr].cookie = cookie;
+		if (++nr == AIO_POLL_BATCH)
+			break;
+	}
+	spin_unlock_irq(&ctx->ctx_lock);
+
+	for (i = 0; i < nr; i++) {
+		blk_poll(batch[i].q, batch[i].cookie);
+		blk_put_queue(batch[i].q);
+	}
+
+	return nr != 0;
+}
+
 static long read_events(struct kioctx *ctx, long min_nr, long nr,
 			struct io_event __user *event,
 			struct timespec __user *timeout)
@@ -1311,12 +1361,43 @@ static long read_events(struct kioctx *ctx, long min_nr, long nr,
 	 * the ringbuffer empty. So in practice we should be ok, but it's
 	 * something to be aware of when touching this code.
 	 */
-	if (until.tv64 == 0)
+	if (until.tv64 == 0) {
 		aio_read_events(ctx, min_nr, nr, event, &ret);
-	else
-		wait_event_interruptible_hrtimeout(ctx->wait,
-				aio_read_events(ctx, min_nr, nr, event, &ret),
-				until);
+	} else {
+		bool bounded = until.tv64 != KTIME_MAX;
+		ktime_t expires = bounded ? ktime_add(ktime_get(), until) :
+					    until;
+
+		/*
+		 * As long as polled (RWF_HIPRI) requests are in flight,
+		 * reap their completions by spinning on the block queues
+		 * rather than sleeping.  Once nothing pollable remains,
+		 * fall through to the interrupt-driven wait below; its
+		 * condition recheck returns immediately if the polling
+		 * loop already satisfied min_nr.
+		 */
+		while (!aio_read_events(ctx, min_nr, nr, event, &ret) &&
+		       !signal_pending(current)) {
+			if (bounded && ktime_after(ktime_get(), expires))
+				break;
+			if (!aio_poll_requests(ctx))
+				break;
+			cond_resched();
+		}
+
+		if (bounded) {
+			until = ktime_sub(expires, ktime_get());
+			if (until.tv64 < 0)
+				until.tv64 = 0;
+		}
+		if (until.tv64 == 0)
+			aio_read_events(ctx, min_nr, nr, event, &ret);
+		else
+			wait_event_interruptible_hrtimeout(ctx->wait,
+					aio_read_events(ctx, min_nr, nr, event,
+							&ret),
+					until);
+	}
 
 	if (!ret && signal_pending(current))
 		ret = -EINTR;
@@ -1506,11 +1587,16 @@ static int io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 	ssize_t ret;
 
 	/* enforce forwards compatibility on users */
-	if (unlikely(iocb->aio_reserved1 || iocb->aio_reserved2)) {
+	if (unlikely(iocb->aio_reserved2)) {
 		pr_debug("EINVAL: reserve field set\n");
 		return -EINVAL;
 	}
 
+	if (unlikely(iocb->aio_rw_flags & ~(RWF_HIPRI | RWF_NOWAIT))) {
+		pr_debug("EINVAL: unsupported aio_rw_flags\n");
+		return -EINVAL;
+	}
+
 	/* prevent overflows */
 	if (unlikely(
 	    (iocb->aio_buf != (unsigned long)iocb->aio_buf) ||
@@ -1533,6 +1619,33 @@ static int io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 	req->common.ki_pos = iocb->aio_offset;
 	req->common.ki_complete = aio_complete;
 	req->common.ki_flags = iocb_flags(req->common.ki_filp);
+	req->common.ki_cookie = BLK_QC_T_NONE;
+
+	if (iocb->aio_rw_flags & RWF_NOWAIT) {
+		if (!(file->f_mode & FMODE_NOWAIT)) {
+			ret = -EOPNOTSUPP;
+			goto out_put_req;
+		}
+		req->common.ki_flags |= IOCB_NOWAIT;
+	}
+
+	if (iocb->aio_rw_flags & RWF_HIPRI) {
+		struct inode *inode = file_inode(file);
+
+		/*
+		 * Only O_DIRECT block device IO ends up with a pollable
+		 * cookie; everything else still completes by interrupt
+		 * and is reaped by the sleeping path of io_getevents().
+		 */
+		if (S_ISBLK(inode->i_mode) &&
+		    (req->common.ki_flags & IOCB_DIRECT)) {
+			req->common.ki_flags |= IOCB_HIPRI;
+			req->ki_poll_q = bdev_get_queue(I_BDEV(inode));
+			spin_lock_irq(&ctx->ctx_lock);
+			list_add(&req->ki_poll_list, &ctx->poll_reqs);
+			spin_unlock_irq(&ctx->ctx_lock);
+		}
+	}
 
 	if (iocb->aio_flags & IOCB_FLAG_RESFD) {
 		/*
@@ -1585,6 +1698,11 @@ static int io_submit_one(struct kioctx *ctx, struct iocb __user *user_iocb,
 		goto out_put_req;
 	return 0;
 out_put_req:
+	if (req->ki_poll_list.next) {
+		spin_lock_irq(&ctx->ctx_lock);
+		list_del(&req->ki_poll_list);
+		spin_unlock_irq(&ctx->ctx_lock);
+	}
 	put_reqs_available(ctx, 1);
 	percpu_ref_put(&ctx->reqs);
 	kiocb_free(req);
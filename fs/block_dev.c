@@ -1946,35 +1946,38 @@ EXPORT_SYMBOL(__invalidate_device);
 void iterate_bdevs(void (*func)(struct block_device *, void *), void *arg)
 {
 	struct inode *inode, *old_inode = NULL;
-
-	spin_lock(&blockdev_superblock->s_inode_list_lock);
-	list_for_each_entry(inode, &blockdev_superblock->s_inodes, i_sb_list) {
-		struct address_space *mapping = inode->i_mapping;
-
-		spin_lock(&inode->i_lock);
-		if (inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW) ||
-		    mapping->nrpages == 0) {
+	struct sb_inodes_shard *shard;
+
+	for_each_sb_inodes_shard(shard, blockdev_superblock) {
+		spin_lock(&shard->lock);
+		list_for_each_entry(inode, &shard->head, i_sb_list) {
+			struct address_space *mapping = inode->i_mapping;
+
+			spin_lock(&inode->i_lock);
+			if (inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW) ||
+			    mapping->nrpages == 0) {
+				spin_unlock(&inode->i_lock);
+				continue;
+			}
+			__iget(inode);
 			spin_unlock(&inode->i_lock);
-			continue;
-		}
-		__iget(inode);
-		spin_unlock(&inode->i_lock);
-		spin_unlock(&blockdev_superblock->s_inode_list_lock);
-		/*
-		 * We hold a reference to 'inode' so it couldn't have been
-		 * removed from s_inodes list while we dropped the
-		 * s_inode_list_lock  We cannot iput the inode now as we can
-		 * be holding the last reference and we cannot iput it under
-		 * s_inode_list_lock. So we keep the reference and iput it
-		 * later.
-		 */
-		iput(old_inode);
-		old_inode = inode;
+			spin_unlock(&shard->lock);
+			/*
+			 * We hold a reference to 'inode' so it couldn't have
+			 * been removed from the s_inodes shard while we
+			 * dropped its lock.  We cannot iput the inode now as
+			 * we can be holding the last reference and we cannot
+			 * iput it under the shard lock. So we keep the
+			 * reference and iput it later.
+			 */
+			iput(old_inode);
+			old_inode = inode;
 
-		func(I_BDEV(inode), arg);
+			func(I_BDEV(inode), arg);
 
-		spin_lock(&blockdev_superblock->s_inode_list_lock);
+			spin_lock(&shard->lock);
+		}
+		spin_unlock(&shard->lock);
 	}
-	spin_unlock(&blockdev_superblock->s_inode_list_lock);
 	iput(old_inode);
 }
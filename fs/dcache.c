@@ -127,6 +127,17 @@ struct dentry_stat_t dentry_stat = {
 
 static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
+static DEFINE_PER_CPU(long, nr_dentry_negative);
+
+/*
+ * Cap on the number of unused negative dentries of one superblock;
+ * zero means no limit. When a superblock goes over the cap, the excess
+ * is pruned from a workqueue and the LRU shrinker spares positive
+ * entries, so that pathological lookup patterns (which can create
+ * negative dentries by the hundreds of millions) cannot flush the hot
+ * positive working set out of the dcache.
+ */
+unsigned long sysctl_negative_dentry_limit __read_mostly;
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 
@@ -160,15 +171,52 @@ static long get_nr_dentry_unused(void)
 	return sum < 0 ? 0 : sum;
 }
 
+static long get_nr_dentry_negative(void)
+{
+	int i;
+	long sum = 0;
+
+	for_each_possible_cpu(i)
+		sum += per_cpu(nr_dentry_negative, i);
+	return sum < 0 ? 0 : sum;
+}
+
 int proc_nr_dentry(struct ctl_table *table, int write, void __user *buffer,
 		   size_t *lenp, loff_t *ppos)
 {
 	dentry_stat.nr_dentry = get_nr_dentry();
 	dentry_stat.nr_unused = get_nr_dentry_unused();
+	dentry_stat.nr_negative = get_nr_dentry_negative();
 	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
 }
 #endif
 
+/*
+ * The negative-dentry counters (the per-cpu one above and the per
+ * superblock s_nr_dentry_negative) follow the same rule as
+ * nr_dentry_unused: they count negative dentries sitting on an LRU or
+ * shrink list, and are updated under d_lock whenever either the list
+ * membership or the type of the dentry changes.
+ */
+static void d_neg_count_inc(struct dentry *dentry)
+{
+	this_cpu_inc(nr_dentry_negative);
+	atomic_long_inc(&dentry->d_sb->s_nr_dentry_negative);
+}
+
+static void d_neg_count_dec(struct dentry *dentry)
+{
+	this_cpu_dec(nr_dentry_negative);
+	atomic_long_dec(&dentry->d_sb->s_nr_dentry_negative);
+}
+
+static bool sb_over_negative_limit(struct super_block *sb)
+{
+	unsigned long limit = READ_ONCE(sysctl_negative_dentry_limit);
+
+	return limit && atomic_long_read(&sb->s_nr_dentry_negative) > limit;
+}
+
 /*
  * Compare 2 name strings, return 0 if they match, otherwise non-zero.
  * The strings are both count bytes long, and count is non-zero.
@@ -288,6 +336,9 @@ static inline void __d_set_inode_and_type(struct dentry *dentry,
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	flags |= type_flags;
 	WRITE_ONCE(dentry->d_flags, flags);
+	/* The dentry stops being negative while sitting on an LRU list */
+	if (flags & DCACHE_LRU_LIST)
+		d_neg_count_dec(dentry);
 }
 
 static inline void __d_clear_type_and_inode(struct dentry *dentry)
@@ -297,6 +348,9 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	WRITE_ONCE(dentry->d_flags, flags);
 	dentry->d_inode = NULL;
+	/* The dentry becomes negative while sitting on an LRU list */
+	if (flags & DCACHE_LRU_LIST)
+		d_neg_count_inc(dentry);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -363,6 +417,15 @@ static void d_lru_add(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, 0);
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
+	if (d_is_negative(dentry)) {
+		d_neg_count_inc(dentry);
+		/*
+		 * This is the one place where the cache gains new unused
+		 * negative entries: push the excess back off a workqueue.
+		 */
+		if (unlikely(sb_over_negative_limit(dentry->d_sb)))
+			schedule_work(&dentry->d_sb->s_neg_dentry_prune);
+	}
 	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -371,6 +434,8 @@ static void d_lru_del(struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_neg_count_dec(dentry);
 	WARN_ON_ONCE(!list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -380,6 +445,8 @@ static void d_shrink_del(struct dentry *dentry)
 	list_del_init(&dentry->d_lru);
 	dentry->d_flags &= ~(DCACHE_SHRINK_LIST | DCACHE_LRU_LIST);
 	this_cpu_dec(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_neg_count_dec(dentry);
 }
 
 static void d_shrink_add(struct dentry *dentry, struct list_head *list)
@@ -388,6 +455,8 @@ static void d_shrink_add(struct dentry *dentry, struct list_head *list)
 	list_add(&dentry->d_lru, list);
 	dentry->d_flags |= DCACHE_SHRINK_LIST | DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_neg_count_inc(dentry);
 }
 
 /*
@@ -401,6 +470,8 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
+	if (d_is_negative(dentry))
+		d_neg_count_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -1068,6 +1139,16 @@ static enum lru_status dentry_lru_isolate(struct list_head *item,
 		return LRU_ROTATE;
 	}
 
+	/*
+	 * While the superblock is over its negative dentry limit, prefer
+	 * reclaiming negative dentries and give positive ones another pass
+	 * through the LRU instead.
+	 */
+	if (!d_is_negative(dentry) && sb_over_negative_limit(dentry->d_sb)) {
+		spin_unlock(&dentry->d_lock);
+		return LRU_ROTATE;
+	}
+
 	d_lru_shrink_move(lru, dentry, freeable);
 	spin_unlock(&dentry->d_lock);
 
@@ -1097,6 +1178,70 @@ long prune_dcache_sb(struct super_block *sb, struct shrink_control *sc)
 	return freed;
 }
 
+static enum lru_status dentry_lru_isolate_negative(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct list_head *freeable = arg;
+	struct dentry	*dentry = container_of(item, struct dentry, d_lru);
+
+	/*
+	 * we are inverting the lru lock/dentry->d_lock here,
+	 * so use a trylock. If we fail to get the lock, just skip
+	 * it
+	 */
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	/*
+	 * Dentries with active counts are picked up by the next regular
+	 * LRU walk; positive ones are what the limit is trying to keep.
+	 */
+	if (dentry->d_lockref.count || !d_is_negative(dentry)) {
+		spin_unlock(&dentry->d_lock);
+		return LRU_SKIP;
+	}
+
+	d_lru_shrink_move(lru, dentry, freeable);
+	spin_unlock(&dentry->d_lock);
+
+	return LRU_REMOVED;
+}
+
+/**
+ * prune_negative_dentries - reclaim excess negative dentries
+ * @work: the superblock's &super_block->s_neg_dentry_prune
+ *
+ * Walk the superblock dcache LRU and dispose of negative dentries until
+ * the superblock drops back under fs.negative-dentry-limit.  Scheduled
+ * from d_lru_add() when an over-limit superblock gains another unused
+ * negative dentry.
+ */
+void prune_negative_dentries(struct work_struct *work)
+{
+	struct super_block *sb = container_of(work, struct super_block,
+					      s_neg_dentry_prune);
+
+	/*
+	 * If the superblock is going away, leave the work to the
+	 * shrink_dcache_for_umount() path.  generic_shutdown_super()
+	 * cancels us before dropping s_umount, so no new work runs
+	 * after that point.
+	 */
+	if (!down_read_trylock(&sb->s_umount))
+		return;
+
+	while (sb->s_root && sb_over_negative_limit(sb)) {
+		LIST_HEAD(dispose);
+
+		if (!list_lru_walk(&sb->s_dentry_lru,
+				   dentry_lru_isolate_negative, &dispose, 1024))
+			break;
+		shrink_dentry_list(&dispose);
+		cond_resched();
+	}
+	up_read(&sb->s_umount);
+}
+
 static enum lru_status dentry_lru_isolate_shrink(struct list_head *item,
 		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
 {
@@ -3609,6 +3754,13 @@ void __init vfs_caches_init(void)
 {
 	names_cachep = kmem_cache_create("names_cache", PATH_MAX, 0,
 			SLAB_HWCACHE_ALIGN|SLAB_PANIC, NULL);
+	/*
+	 * getname()/putname() allocate and free in tight bursts during
+	 * path walks; a small per-cpu array keeps those round trips off
+	 * the page freelists.  Best effort: the cache works as before
+	 * if the array cannot be set up.
+	 */
+	kmem_cache_setup_percpu_array(names_cachep, 16);
 
 	dcache_init();
 	inode_init();
@@ -419,6 +419,15 @@ static inline void dio_bio_submit(struct dio *dio, struct dio_submit *sdio)
 	} else
 		dio->bio_cookie = submit_bio(bio);
 
+	/*
+	 * Let async pollers find the bio; the submitter's reference on
+	 * the dio keeps the iocb alive until all bios are submitted.
+	 * Only the last bio can be polled for, the others are assumed
+	 * to complete in its vicinity.
+	 */
+	if (dio->is_async && (dio->iocb->ki_flags & IOCB_HIPRI))
+		WRITE_ONCE(dio->iocb->ki_cookie, dio->bio_cookie);
+
 	sdio->bio = NULL;
 	sdio->boundary = 0;
 	sdio->logical_offset_in_bio = 0;
@@ -554,7 +563,7 @@ static inline int dio_bio_reap(struct dio *dio, struct dio_submit *sdio)
  * filesystems that don't need it and also allows us to create the workqueue
  * late enough so the we can include s_id in the name of the workqueue.
  */
-static int sb_init_dio_done_wq(struct super_block *sb)
+int sb_init_dio_done_wq(struct super_block *sb)
 {
 	struct workqueue_struct *old;
 	struct workqueue_struct *wq = alloc_workqueue("dio/%s",
@@ -1213,6 +1222,8 @@ do_blockdev_direct_IO(struct kiocb *iocb, struct inode *inode,
 	} else {
 		dio->op = REQ_OP_READ;
 	}
+	if (iocb->ki_flags & IOCB_NOWAIT)
+		dio->op_flags |= REQ_NOWAIT;
 
 	/*
 	 * For AIO O_(D)SYNC writes we need to defer completions to a workqueue
@@ -2462,6 +2462,7 @@ int ext4_dax_get_block(struct inode *inode, sector_t iblock,
 		       struct buffer_head *bh_result, int create);
 int ext4_get_block(struct inode *inode, sector_t iblock,
 		   struct buffer_head *bh_result, int create);
+extern struct iomap_ops ext4_iomap_ops;
 int ext4_dio_get_block(struct inode *inode, sector_t iblock,
 		       struct buffer_head *bh_result, int create);
 int ext4_da_get_block_prep(struct inode *inode, sector_t iblock,
@@ -2370,6 +2370,105 @@ bool try_to_writeback_inodes_sb(struct super_block *sb, enum wb_reason reason)
 }
 EXPORT_SYMBOL(try_to_writeback_inodes_sb);
 
+/* serves the shard workers of parallel sb-wide sync */
+static struct workqueue_struct *sync_shards_wq;
+
+struct sync_shard_work {
+	struct work_struct	work;
+	struct super_block	*sb;
+	unsigned int		first_shard;
+	unsigned int		nr_workers;
+};
+
+/*
+ * Start writeback of every dirty inode on one s_inodes shard.  This is
+ * plain data submission as fsync(2) would do it; the inodes themselves
+ * are left dirty and are written (and waited for) by the regular
+ * flusher pass that follows.
+ */
+static void sync_inodes_shard(struct super_block *sb,
+			      struct sb_inodes_shard *shard)
+{
+	struct inode *inode, *toput_inode = NULL;
+
+	spin_lock(&shard->lock);
+	list_for_each_entry(inode, &shard->head, i_sb_list) {
+		struct address_space *mapping = inode->i_mapping;
+
+		spin_lock(&inode->i_lock);
+		if ((inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW)) ||
+		    !mapping_tagged(mapping, PAGECACHE_TAG_DIRTY)) {
+			spin_unlock(&inode->i_lock);
+			continue;
+		}
+		__iget(inode);
+		spin_unlock(&inode->i_lock);
+		spin_unlock(&shard->lock);
+
+		filemap_fdatawrite(mapping);
+
+		cond_resched();
+		iput(toput_inode);
+		toput_inode = inode;
+
+		spin_lock(&shard->lock);
+	}
+	spin_unlock(&shard->lock);
+	iput(toput_inode);
+}
+
+static void sync_shard_workfn(struct work_struct *work)
+{
+	struct sync_shard_work *ssw = container_of(work,
+					struct sync_shard_work, work);
+	unsigned int i;
+
+	for (i = ssw->first_shard; i < SB_INODES_NR_SHARDS;
+	     i += ssw->nr_workers)
+		sync_inodes_shard(ssw->sb, &ssw->sb->s_inodes[i]);
+}
+
+/*
+ * Fan the initial page submission of an sb-wide sync out to several
+ * workers when the bdi asks for it (nr_flush_workers > 1).  The shards
+ * of the s_inodes list partition the inodes, and a given shard is
+ * always handled by the same worker, so pages of one file are still
+ * submitted sequentially by a single context.  Purely advisory: on
+ * allocation failure the serial flusher pass below does all the work.
+ */
+static void sync_inodes_sb_parallel(struct super_block *sb)
+{
+	struct sync_shard_work *works;
+	unsigned int nr, i;
+
+	nr = min_t(unsigned int, READ_ONCE(sb->s_bdi->nr_flush_workers),
+		   SB_INODES_NR_SHARDS);
+	if (nr <= 1 || !sync_shards_wq)
+		return;
+
+	works = kcalloc(nr, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return;
+
+	for (i = 0; i < nr; i++) {
+		works[i].sb = sb;
+		works[i].first_shard = i;
+		works[i].nr_workers = nr;
+		INIT_WORK(&works[i].work, sync_shard_workfn);
+		queue_work(sync_shards_wq, &works[i].work);
+	}
+	for (i = 0; i < nr; i++)
+		flush_work(&works[i].work);
+	kfree(works);
+}
+
+static int __init sync_shards_init(void)
+{
+	sync_shards_wq = alloc_workqueue("sync_shards", WQ_UNBOUND, 0);
+	return sync_shards_wq ? 0 : -ENOMEM;
+}
+fs_initcall(sync_shards_init);
+
 /**
  * sync_inodes_sb	-	sync sb inode pages
  * @sb: the superblock
@@ -2400,6 +2499,8 @@ void sync_inodes_sb(struct super_block *sb)
 		return;
 	WARN_ON(!rwsem_is_locked(&sb->s_umount));
 
+	sync_inodes_sb_parallel(sb);
+
 	bdi_split_work_to_wbs(bdi, &work, false);
 	wb_wait_for_completion(bdi, &done);
 
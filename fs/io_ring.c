@@ -0,0 +1,452 @@
+/*
+ * Ring-based asynchronous I/O over shared submission/completion queues.
+ *
+ * An application opens /dev/io_ring, sizes the rings with
+ * IO_RING_IOC_SETUP and maps the submission queue header, the
+ * completion queue and the sqe array.  IO_RING_IOC_ENTER consumes the
+ * published sqes in one syscall; each request is executed from a
+ * workqueue on behalf of the submitting task (its mm is borrowed for
+ * the duration of the request), so buffered reads and writes that
+ * block on IO or the page cache never block submission.  Completions
+ * are posted to the cq ring and can additionally be waited for from
+ * IO_RING_IOC_ENTER or polled via poll(2)/epoll on the device fd.
+ *
+ * See include/uapi/linux/io_ring.h for the shared data structures.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/errno.h>
+#include <linux/cred.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/mm.h>
+#include <linux/mmu_context.h>
+#include <linux/miscdevice.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#include <uapi/linux/io_ring.h>
+
+#define IO_RING_MAX_ENTRIES	32768
+
+struct io_ring_ctx {
+	/* serializes setup and sqe consumption */
+	struct mutex		uring_lock;
+
+	struct io_ring_sq	*sq_ring;
+	struct io_ring_cq	*cq_ring;
+	struct io_ring_sqe	*sqes;
+	unsigned int		sq_entries;
+	unsigned int		cq_entries;
+	/*
+	 * The rings are mapped writable into the application, so the
+	 * ring_mask/tail words they carry are not to be trusted: index
+	 * only through these kernel-side copies.
+	 */
+	unsigned int		sq_mask;
+	unsigned int		cq_mask;
+	/* next sqe to consume; mirrored to sq_ring->head for the app */
+	unsigned int		cached_sq_head;
+	/* next cqe slot; mirrored to cq_ring->tail once published */
+	unsigned int		cached_cq_tail;
+
+	/* mm of the task that set the ring up; sqe->addr is resolved in it */
+	struct mm_struct	*mm;
+	/* creds of that task; requests run with them, not the kworker's */
+	const struct cred	*creds;
+
+	/* protects cq_ring tail and overflow */
+	spinlock_t		completion_lock;
+	wait_queue_head_t	cq_wait;
+
+	/* in-flight requests, release waits for it to drain */
+	atomic_t		pending;
+	wait_queue_head_t	idle_wait;
+};
+
+struct io_ring_req {
+	struct work_struct	work;
+	struct io_ring_ctx	*ctx;
+	struct file		*file;
+	struct io_ring_sqe	sqe;
+};
+
+static struct workqueue_struct *io_ring_wq;
+
+static unsigned int io_ring_cq_ready(struct io_ring_ctx *ctx)
+{
+	return READ_ONCE(ctx->cached_cq_tail) -
+	       READ_ONCE(ctx->cq_ring->head);
+}
+
+static void io_ring_post_cqe(struct io_ring_ctx *ctx, u64 user_data, long res)
+{
+	struct io_ring_cq *cq = ctx->cq_ring;
+	unsigned long flags;
+	unsigned int tail;
+
+	spin_lock_irqsave(&ctx->completion_lock, flags);
+	tail = ctx->cached_cq_tail;
+	if (tail - READ_ONCE(cq->head) == ctx->cq_entries) {
+		cq->overflow++;
+	} else {
+		struct io_ring_cqe *cqe = &cq->cqes[tail & ctx->cq_mask];
+
+		cqe->user_data = user_data;
+		cqe->res = res;
+		cqe->__pad = 0;
+		ctx->cached_cq_tail = tail + 1;
+		/* publish the cqe before moving the tail */
+		smp_store_release(&cq->tail, tail + 1);
+	}
+	spin_unlock_irqrestore(&ctx->completion_lock, flags);
+
+	wake_up_interruptible(&ctx->cq_wait);
+}
+
+static void io_ring_req_workfn(struct work_struct *work)
+{
+	struct io_ring_req *req = container_of(work, struct io_ring_req, work);
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_ring_sqe *sqe = &req->sqe;
+	void __user *buf = (void __user *)(unsigned long)sqe->addr;
+	const struct cred *old_cred;
+	mm_segment_t old_fs;
+	loff_t pos = sqe->off;
+	long ret;
+
+	/*
+	 * Requests run from a kernel thread: borrow the submitter's mm so
+	 * sqe->addr resolves in its address space, drop back to USER_DS
+	 * so the address is subject to the usual access checks, and
+	 * assume the submitter's creds so rw_verify_area() and the LSMs
+	 * judge the task that issued the request, not the kworker.
+	 */
+	old_cred = override_creds(ctx->creds);
+	use_mm(ctx->mm);
+	old_fs = get_fs();
+	set_fs(USER_DS);
+
+	switch (sqe->opcode) {
+	case IO_RING_OP_NOP:
+		ret = 0;
+		break;
+	case IO_RING_OP_READ:
+		ret = vfs_read(req->file, buf, sqe->len, &pos);
+		break;
+	case IO_RING_OP_WRITE:
+		ret = vfs_write(req->file, buf, sqe->len, &pos);
+		break;
+	case IO_RING_OP_FSYNC:
+		ret = vfs_fsync(req->file,
+				sqe->rw_flags & IO_RING_FSYNC_DATASYNC);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	set_fs(old_fs);
+	unuse_mm(ctx->mm);
+	revert_creds(old_cred);
+
+	if (req->file)
+		fput(req->file);
+	io_ring_post_cqe(ctx, sqe->user_data, ret);
+	kfree(req);
+
+	if (atomic_dec_and_test(&ctx->pending))
+		wake_up(&ctx->idle_wait);
+}
+
+/*
+ * Consume up to @to_submit published sqes.  Malformed entries are
+ * accounted in sq->dropped and get an -EINVAL completion, so the
+ * application never loses track of a user_data.
+ */
+static int io_ring_submit(struct io_ring_ctx *ctx, unsigned int to_submit)
+{
+	struct io_ring_sq *sq = ctx->sq_ring;
+	int submitted = 0;
+
+	while (to_submit--) {
+		struct io_ring_req *req;
+		unsigned int head = ctx->cached_sq_head;
+
+		/* pairs with the application publishing the tail */
+		if (head == smp_load_acquire(&sq->tail))
+			break;
+
+		req = kzalloc(sizeof(*req), GFP_KERNEL);
+		if (!req)
+			return submitted ? submitted : -ENOMEM;
+
+		req->sqe = ctx->sqes[head & ctx->sq_mask];
+		ctx->cached_sq_head = head + 1;
+		/* the sqe slot may be reused once the head moves */
+		smp_store_release(&sq->head, head + 1);
+
+		if (req->sqe.opcode >= IO_RING_OP_LAST || req->sqe.flags) {
+			sq->dropped++;
+			io_ring_post_cqe(ctx, req->sqe.user_data, -EINVAL);
+			kfree(req);
+			continue;
+		}
+
+		if (req->sqe.opcode != IO_RING_OP_NOP) {
+			req->file = fget(req->sqe.fd);
+			if (!req->file) {
+				io_ring_post_cqe(ctx, req->sqe.user_data,
+						 -EBADF);
+				kfree(req);
+				continue;
+			}
+		}
+
+		req->ctx = ctx;
+		INIT_WORK(&req->work, io_ring_req_workfn);
+		atomic_inc(&ctx->pending);
+		queue_work(io_ring_wq, &req->work);
+		submitted++;
+	}
+
+	return submitted;
+}
+
+static size_t io_ring_cq_size(unsigned int cq_entries)
+{
+	return sizeof(struct io_ring_cq) +
+	       cq_entries * sizeof(struct io_ring_cqe);
+}
+
+static int io_ring_setup(struct io_ring_ctx *ctx, struct io_ring_params *p)
+{
+	unsigned int sq_entries, cq_entries;
+	struct io_ring_sq *sq_ring;
+	struct io_ring_cq *cq_ring;
+	struct io_ring_sqe *sqes;
+
+	if (p->flags || p->resv[0] || p->resv[1] || p->resv[2] ||
+	    p->resv[3] || p->resv[4])
+		return -EINVAL;
+	if (!p->sq_entries || p->sq_entries > IO_RING_MAX_ENTRIES)
+		return -EINVAL;
+	if (ctx->sq_ring)
+		return -EBUSY;
+
+	sq_entries = roundup_pow_of_two(p->sq_entries);
+	/*
+	 * Twice the sq size, so that a full resubmission cannot overflow
+	 * completions from the previous batch.
+	 */
+	cq_entries = 2 * sq_entries;
+
+	sq_ring = vmalloc_user(sizeof(struct io_ring_sq));
+	cq_ring = vmalloc_user(io_ring_cq_size(cq_entries));
+	sqes = vmalloc_user(sq_entries * sizeof(struct io_ring_sqe));
+	if (!sq_ring || !cq_ring || !sqes) {
+		vfree(sq_ring);
+		vfree(cq_ring);
+		vfree(sqes);
+		return -ENOMEM;
+	}
+
+	sq_ring->ring_mask = sq_entries - 1;
+	sq_ring->ring_entries = sq_entries;
+	cq_ring->ring_mask = cq_entries - 1;
+	cq_ring->ring_entries = cq_entries;
+
+	ctx->mm = current->mm;
+	atomic_inc(&ctx->mm->mm_count);
+	ctx->creds = get_current_cred();
+
+	ctx->sq_entries = sq_entries;
+	ctx->cq_entries = cq_entries;
+	ctx->sq_mask = sq_entries - 1;
+	ctx->cq_mask = cq_entries - 1;
+	ctx->cq_ring = cq_ring;
+	ctx->sqes = sqes;
+	/* publish last: mmap and poll test sq_ring for a finished setup */
+	smp_store_release(&ctx->sq_ring, sq_ring);
+
+	p->sq_entries = sq_entries;
+	p->cq_entries = cq_entries;
+	return 0;
+}
+
+static long io_ring_ioctl(struct file *file, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct io_ring_ctx *ctx = file->private_data;
+	void __user *argp = (void __user *)arg;
+	long ret;
+
+	switch (cmd) {
+	case IO_RING_IOC_SETUP: {
+		struct io_ring_params p;
+
+		if (copy_from_user(&p, argp, sizeof(p)))
+			return -EFAULT;
+		mutex_lock(&ctx->uring_lock);
+		ret = io_ring_setup(ctx, &p);
+		mutex_unlock(&ctx->uring_lock);
+		if (!ret && copy_to_user(argp, &p, sizeof(p)))
+			ret = -EFAULT;
+		return ret;
+	}
+	case IO_RING_IOC_ENTER: {
+		struct io_ring_enter e;
+
+		if (copy_from_user(&e, argp, sizeof(e)))
+			return -EFAULT;
+		if (e.flags || e.resv)
+			return -EINVAL;
+		if (!smp_load_acquire(&ctx->sq_ring))
+			return -ENXIO;
+
+		ret = 0;
+		if (e.to_submit) {
+			mutex_lock(&ctx->uring_lock);
+			ret = io_ring_submit(ctx, e.to_submit);
+			mutex_unlock(&ctx->uring_lock);
+			if (ret < 0)
+				return ret;
+		}
+		if (e.min_complete) {
+			unsigned int want = min(e.min_complete,
+						ctx->cq_entries);
+			int err;
+
+			err = wait_event_interruptible(ctx->cq_wait,
+					io_ring_cq_ready(ctx) >= want);
+			if (err)
+				return err;
+		}
+		return ret;
+	}
+	}
+	return -ENOTTY;
+}
+
+static int io_ring_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct io_ring_ctx *ctx = file->private_data;
+	loff_t offset = (loff_t)vma->vm_pgoff << PAGE_SHIFT;
+	unsigned long sz = vma->vm_end - vma->vm_start;
+	size_t region_sz;
+	void *ptr;
+
+	if (!smp_load_acquire(&ctx->sq_ring))
+		return -ENXIO;
+
+	switch (offset) {
+	case IO_RING_OFF_SQ_RING:
+		ptr = ctx->sq_ring;
+		region_sz = sizeof(struct io_ring_sq);
+		break;
+	case IO_RING_OFF_CQ_RING:
+		ptr = ctx->cq_ring;
+		region_sz = io_ring_cq_size(ctx->cq_entries);
+		break;
+	case IO_RING_OFF_SQES:
+		ptr = ctx->sqes;
+		region_sz = ctx->sq_entries * sizeof(struct io_ring_sqe);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (sz > PAGE_ALIGN(region_sz))
+		return -EINVAL;
+	return remap_vmalloc_range(vma, ptr, 0);
+}
+
+static unsigned int io_ring_poll(struct file *file, poll_table *wait)
+{
+	struct io_ring_ctx *ctx = file->private_data;
+	unsigned int mask = 0;
+
+	poll_wait(file, &ctx->cq_wait, wait);
+
+	if (!smp_load_acquire(&ctx->sq_ring))
+		return mask;
+
+	if (io_ring_cq_ready(ctx))
+		mask |= POLLIN | POLLRDNORM;
+	if (READ_ONCE(ctx->sq_ring->tail) - READ_ONCE(ctx->cached_sq_head) <
+	    ctx->sq_entries)
+		mask |= POLLOUT | POLLWRNORM;
+
+	return mask;
+}
+
+static int io_ring_open(struct inode *inode, struct file *file)
+{
+	struct io_ring_ctx *ctx;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	mutex_init(&ctx->uring_lock);
+	spin_lock_init(&ctx->completion_lock);
+	init_waitqueue_head(&ctx->cq_wait);
+	init_waitqueue_head(&ctx->idle_wait);
+	atomic_set(&ctx->pending, 0);
+
+	file->private_data = ctx;
+	return nonseekable_open(inode, file);
+}
+
+static int io_ring_release(struct inode *inode, struct file *file)
+{
+	struct io_ring_ctx *ctx = file->private_data;
+
+	/* in-flight requests hold files and the mm; let them drain */
+	wait_event(ctx->idle_wait, !atomic_read(&ctx->pending));
+
+	if (ctx->mm)
+		mmdrop(ctx->mm);
+	if (ctx->creds)
+		put_cred(ctx->creds);
+	vfree(ctx->sq_ring);
+	vfree(ctx->cq_ring);
+	vfree(ctx->sqes);
+	kfree(ctx);
+	return 0;
+}
+
+static const struct file_operations io_ring_fops = {
+	.owner		= THIS_MODULE,
+	.open		= io_ring_open,
+	.release	= io_ring_release,
+	.unlocked_ioctl	= io_ring_ioctl,
+	.mmap		= io_ring_mmap,
+	.poll		= io_ring_poll,
+	.llseek		= no_llseek,
+};
+
+static struct miscdevice io_ring_misc = {
+	.minor		= MISC_DYNAMIC_MINOR,
+	.name		= "io_ring",
+	.fops		= &io_ring_fops,
+};
+
+static int __init io_ring_init(void)
+{
+	int ret;
+
+	io_ring_wq = alloc_workqueue("io_ring", WQ_UNBOUND, 0);
+	if (!io_ring_wq)
+		return -ENOMEM;
+
+	ret = misc_register(&io_ring_misc);
+	if (ret)
+		destroy_workqueue(io_ring_wq);
+	return ret;
+}
+fs_initcall(io_ring_init);
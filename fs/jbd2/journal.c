@@ -723,6 +723,69 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
  * the transaction id is stale, it is by definition already completed,
  * so just return SUCCESS.
  */
+/*
+ * jbd2_fsync_transaction - wait for a commit to finish on behalf of fsync
+ * @journal: journal to wait on
+ * @tid: transaction the caller's metadata updates belong to
+ * @needs_barrier: set if the caller must flush the device cache itself
+ *
+ * Like jbd2_complete_transaction(), but additionally decides in the same
+ * j_state_lock section whether the commit of @tid will issue a cache
+ * flush covering the caller's previously submitted data writes (the
+ * jbd2_trans_will_send_data_barrier() test).  fsync-heavy small-file
+ * workloads otherwise take the shared state lock twice per fsync.
+ */
+int jbd2_fsync_transaction(journal_t *journal, tid_t tid, bool *needs_barrier)
+{
+	transaction_t *commit_trans;
+	int need_to_wait = 1;
+
+	*needs_barrier = false;
+
+	read_lock(&journal->j_state_lock);
+
+	if (journal->j_flags & JBD2_BARRIER) {
+		bool will_flush = false;
+
+		/*
+		 * An already committed transaction flushed in the past and
+		 * does not cover the caller's data writes any more.
+		 */
+		if (!tid_geq(journal->j_commit_sequence, tid)) {
+			commit_trans = journal->j_committing_transaction;
+			if (!commit_trans || commit_trans->t_tid != tid) {
+				/* the commit is still to come and will flush */
+				will_flush = true;
+			} else if (journal->j_fs_dev != journal->j_dev) {
+				will_flush = commit_trans->t_need_data_flush &&
+				      commit_trans->t_state < T_COMMIT_DFLUSH;
+			} else {
+				will_flush =
+				      commit_trans->t_state < T_COMMIT_JFLUSH;
+			}
+		}
+		*needs_barrier = !will_flush;
+	}
+
+	if (journal->j_running_transaction &&
+	    journal->j_running_transaction->t_tid == tid) {
+		if (journal->j_commit_request != tid) {
+			/* transaction not yet started, so request it */
+			read_unlock(&journal->j_state_lock);
+			jbd2_log_start_commit(journal, tid);
+			goto wait_commit;
+		}
+	} else if (!(journal->j_committing_transaction &&
+		     journal->j_committing_transaction->t_tid == tid))
+		need_to_wait = 0;
+	read_unlock(&journal->j_state_lock);
+	if (!need_to_wait)
+		return 0;
+wait_commit:
+	return jbd2_log_wait_commit(journal, tid);
+}
+EXPORT_SYMBOL(jbd2_fsync_transaction);
+
 int jbd2_complete_transaction(journal_t *journal, tid_t tid)
 {
 	int	need_to_wait = 1;
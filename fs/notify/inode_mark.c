@@ -146,81 +146,88 @@ int fsnotify_add_inode_mark(struct fsnotify_mark *mark,
  * @sb: superblock being unmounted.
  *
  * Called during unmount with no locks held, so needs to be safe against
- * concurrent modifiers. We temporarily drop sb->s_inode_list_lock and CAN block.
+ * concurrent modifiers. We temporarily drop the shard lock and CAN block.
  */
 void fsnotify_unmount_inodes(struct super_block *sb)
 {
 	struct inode *inode, *next_i, *need_iput = NULL;
+	struct sb_inodes_shard *shard;
+
+	for_each_sb_inodes_shard(shard, sb) {
+		spin_lock(&shard->lock);
+		list_for_each_entry_safe(inode, next_i, &shard->head,
+					 i_sb_list) {
+			struct inode *need_iput_tmp;
+
+			/*
+			 * We cannot __iget() an inode in state I_FREEING,
+			 * I_WILL_FREE, or I_NEW which is fine because by that
+			 * point the inode cannot have any associated watches.
+			 */
+			spin_lock(&inode->i_lock);
+			if (inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW)) {
+				spin_unlock(&inode->i_lock);
+				continue;
+			}
 
-	spin_lock(&sb->s_inode_list_lock);
-	list_for_each_entry_safe(inode, next_i, &sb->s_inodes, i_sb_list) {
-		struct inode *need_iput_tmp;
+			/*
+			 * If i_count is zero, the inode cannot have any
+			 * watches and doing an __iget/iput with MS_ACTIVE
+			 * clear would actually evict all inodes with zero
+			 * i_count from icache which is unnecessarily violent
+			 * and may in fact be illegal to do.
+			 */
+			if (!atomic_read(&inode->i_count)) {
+				spin_unlock(&inode->i_lock);
+				continue;
+			}
 
-		/*
-		 * We cannot __iget() an inode in state I_FREEING,
-		 * I_WILL_FREE, or I_NEW which is fine because by that point
-		 * the inode cannot have any associated watches.
-		 */
-		spin_lock(&inode->i_lock);
-		if (inode->i_state & (I_FREEING|I_WILL_FREE|I_NEW)) {
-			spin_unlock(&inode->i_lock);
-			continue;
-		}
+			need_iput_tmp = need_iput;
+			need_iput = NULL;
 
-		/*
-		 * If i_count is zero, the inode cannot have any watches and
-		 * doing an __iget/iput with MS_ACTIVE clear would actually
-		 * evict all inodes with zero i_count from icache which is
-		 * unnecessarily violent and may in fact be illegal to do.
-		 */
-		if (!atomic_read(&inode->i_count)) {
+			/* In case fsnotify_inode_delete() drops a reference. */
+			if (inode != need_iput_tmp)
+				__iget(inode);
+			else
+				need_iput_tmp = NULL;
 			spin_unlock(&inode->i_lock);
-			continue;
-		}
 
-		need_iput_tmp = need_iput;
-		need_iput = NULL;
-
-		/* In case fsnotify_inode_delete() drops a reference. */
-		if (inode != need_iput_tmp)
-			__iget(inode);
-		else
-			need_iput_tmp = NULL;
-		spin_unlock(&inode->i_lock);
-
-		/* In case the dropping of a reference would nuke next_i. */
-		while (&next_i->i_sb_list != &sb->s_inodes) {
-			spin_lock(&next_i->i_lock);
-			if (!(next_i->i_state & (I_FREEING | I_WILL_FREE)) &&
-						atomic_read(&next_i->i_count)) {
-				__iget(next_i);
-				need_iput = next_i;
+			/* In case dropping a reference would nuke next_i. */
+			while (&next_i->i_sb_list != &shard->head) {
+				spin_lock(&next_i->i_lock);
+				if (!(next_i->i_state &
+						(I_FREEING | I_WILL_FREE)) &&
+				    atomic_read(&next_i->i_count)) {
+					__iget(next_i);
+					need_iput = next_i;
+					spin_unlock(&next_i->i_lock);
+					break;
+				}
 				spin_unlock(&next_i->i_lock);
-				break;
+				next_i = list_next_entry(next_i, i_sb_list);
 			}
-			spin_unlock(&next_i->i_lock);
-			next_i = list_next_entry(next_i, i_sb_list);
-		}
 
-		/*
-		 * We can safely drop s_inode_list_lock here because either
-		 * we actually hold references on both inode and next_i or
-		 * end of list.  Also no new inodes will be added since the
-		 * umount has begun.
-		 */
-		spin_unlock(&sb->s_inode_list_lock);
+			/*
+			 * We can safely drop the shard lock here because
+			 * either we actually hold references on both inode
+			 * and next_i or end of list.  Also no new inodes
+			 * will be added since the umount has begun.
+			 */
+			spin_unlock(&shard->lock);
 
-		if (need_iput_tmp)
-			iput(need_iput_tmp);
+			if (need_iput_tmp)
+				iput(need_iput_tmp);
 
-		/* for each watch, send FS_UNMOUNT and then remove it */
-		fsnotify(inode, FS_UNMOUNT, inode, FSNOTIFY_EVENT_INODE, NULL, 0);
+			/* for each watch, send FS_UNMOUNT and remove it */
+			fsnotify(inode, FS_UNMOUNT, inode,
+				 FSNOTIFY_EVENT_INODE, NULL, 0);
 
-		fsnotify_inode_delete(inode);
+			fsnotify_inode_delete(inode);
 
-		iput(inode);
+			iput(inode);
 
-		spin_lock(&sb->s_inode_list_lock);
+			spin_lock(&shard->lock);
+		}
+		spin_unlock(&shard->lock);
 	}
-	spin_unlock(&sb->s_inode_list_lock);
 }
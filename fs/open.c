@@ -756,6 +756,16 @@ static int do_dentry_open(struct file *f,
 	}
 	if ((f->f_mode & (FMODE_READ | FMODE_WRITE)) == FMODE_READ)
 		i_readcount_inc(inode);
+	if (f->f_mode & FMODE_WRITE) {
+		/*
+		 * Huge pages in the page cache can't be written to yet. Drop
+		 * all of them before processing writes; collapse_file() takes
+		 * i_writecount (which get_write_access() above has already
+		 * raised) to keep new ones from appearing underneath us.
+		 */
+		if (filemap_nr_thps(inode->i_mapping))
+			truncate_pagecache(inode, 0);
+	}
 	if ((f->f_mode & FMODE_READ) &&
 	     likely(f->f_op->read || f->f_op->read_iter))
 		f->f_mode |= FMODE_CAN_READ;
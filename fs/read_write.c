@@ -680,7 +680,7 @@ static ssize_t do_iter_readv_writev(struct file *filp, struct iov_iter *iter,
 	struct kiocb kiocb;
 	ssize_t ret;
 
-	if (flags & ~(RWF_HIPRI | RWF_DSYNC | RWF_SYNC))
+	if (flags & ~(RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT))
 		return -EOPNOTSUPP;
 
 	init_sync_kiocb(&kiocb, filp);
@@ -690,6 +690,11 @@ static ssize_t do_iter_readv_writev(struct file *filp, struct iov_iter *iter,
 		kiocb.ki_flags |= IOCB_DSYNC;
 	if (flags & RWF_SYNC)
 		kiocb.ki_flags |= (IOCB_DSYNC | IOCB_SYNC);
+	if (flags & RWF_NOWAIT) {
+		if (!(filp->f_mode & FMODE_NOWAIT))
+			return -EOPNOTSUPP;
+		kiocb.ki_flags |= IOCB_NOWAIT;
+	}
 	kiocb.ki_pos = *ppos;
 
 	ret = fn(&kiocb, iter);
@@ -1531,10 +1536,6 @@ ssize_t vfs_copy_file_range(struct file *file_in, loff_t pos_in,
 	    (file_out->f_flags & O_APPEND))
 		return -EBADF;
 
-	/* this could be relaxed once a method supports cross-fs copies */
-	if (inode_in->i_sb != inode_out->i_sb)
-		return -EXDEV;
-
 	if (len == 0)
 		return 0;
 
@@ -1543,13 +1544,44 @@ ssize_t vfs_copy_file_range(struct file *file_in, loff_t pos_in,
 		return ret;
 
 	ret = -EOPNOTSUPP;
-	if (file_out->f_op->copy_file_range)
-		ret = file_out->f_op->copy_file_range(file_in, pos_in, file_out,
-						      pos_out, len, flags);
-	if (ret == -EOPNOTSUPP)
-		ret = do_splice_direct(file_in, &pos_in, file_out, &pos_out,
-				len > MAX_RW_COUNT ? MAX_RW_COUNT : len, 0);
 
+	/*
+	 * Cloning and copy offload only work within one filesystem; for
+	 * cross-filesystem copies we go straight to the splice loop below.
+	 */
+	if (inode_in->i_sb == inode_out->i_sb) {
+		/*
+		 * Try cloning first: it is supported by more filesystems
+		 * and a successful reflink avoids touching the data at
+		 * all.  A failed clone may still be copyable (e.g. the
+		 * range is not block aligned), so fall through.
+		 */
+		if (file_in->f_op->clone_file_range) {
+			ret = file_in->f_op->clone_file_range(file_in, pos_in,
+					file_out, pos_out, len);
+			if (ret == 0) {
+				ret = len;
+				goto done;
+			}
+		}
+
+		if (file_out->f_op->copy_file_range) {
+			ret = file_out->f_op->copy_file_range(file_in, pos_in,
+					file_out, pos_out, len, flags);
+			if (ret != -EOPNOTSUPP)
+				goto done;
+		}
+	}
+
+	/*
+	 * Splice moves page cache pages through an internal pipe without
+	 * bouncing the data through a user buffer, and works across
+	 * filesystems.
+	 */
+	ret = do_splice_direct(file_in, &pos_in, file_out, &pos_out,
+			len > MAX_RW_COUNT ? MAX_RW_COUNT : len, 0);
+
+done:
 	if (ret > 0) {
 		fsnotify_access(file_in);
 		add_rchar(current, ret);
@@ -145,6 +145,14 @@ struct backing_dev_info {
 	unsigned int min_ratio;
 	unsigned int max_ratio, max_prop_frac;
 
+	/*
+	 * Number of workers used to submit dirty pages during sb-wide
+	 * data-integrity sync.  The default of 1 keeps the traditional
+	 * single flusher behaviour; raising it lets striped or JBOD
+	 * devices hiding behind one bdi be driven in parallel.
+	 */
+	unsigned int nr_flush_workers;
+
 	/*
 	 * Sum of avg_write_bw of wbs with dirty inodes.  > 0 if there are
 	 * any dirty wbs, which is depended upon by bdi_has_dirty().
@@ -53,6 +53,12 @@ struct blk_mq_hw_ctx {
 	unsigned long		poll_considered;
 	unsigned long		poll_invoked;
 	unsigned long		poll_success;
+
+	/*
+	 * EWMA of the completion latency seen by pollers on this hctx,
+	 * used to size the sleep of hybrid polling.
+	 */
+	u64			poll_mean_ns;
 };
 
 struct blk_mq_tag_set {
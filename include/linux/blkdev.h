@@ -420,6 +420,12 @@ struct request_queue {
 	unsigned int		request_fn_active;
 
 	unsigned int		rq_timeout;
+	/*
+	 * Hybrid polling: -1 disables it (pure spin), 0 sleeps for half
+	 * of the mean completion latency measured per hctx, > 0 sleeps
+	 * for that fixed number of nanoseconds before spinning.
+	 */
+	int			poll_nsec;
 	struct timer_list	timeout;
 	struct work_struct	timeout_work;
 	struct list_head	timeout_list;
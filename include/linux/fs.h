@@ -143,6 +143,9 @@ typedef int (dio_iodone_t)(struct kiocb *iocb, loff_t offset,
 /* File was opened by fanotify and shouldn't generate fanotify events */
 #define FMODE_NONOTIFY		((__force fmode_t)0x4000000)
 
+/* File is capable of returning -EAGAIN if I/O will block */
+#define FMODE_NOWAIT		((__force fmode_t)0x8000000)
+
 /*
  * Flag for rw_copy_check_uvector and compat_rw_copy_check_uvector
  * that indicates that they should check the contents of the iovec are
@@ -322,6 +325,7 @@ struct writeback_control;
 #define IOCB_DSYNC		(1 << 4)
 #define IOCB_SYNC		(1 << 5)
 #define IOCB_WRITE		(1 << 6)
+#define IOCB_NOWAIT		(1 << 7)
 
 struct kiocb {
 	struct file		*ki_filp;
@@ -329,6 +333,8 @@ struct kiocb {
 	void (*ki_complete)(struct kiocb *iocb, long ret, long ret2);
 	void			*private;
 	int			ki_flags;
+	/* cookie of the last bio submitted for an IOCB_HIPRI request */
+	blk_qc_t		ki_cookie;
 };
 
 static inline bool is_sync_kiocb(struct kiocb *kiocb)
@@ -439,6 +445,10 @@ struct address_space {
 	unsigned long		nrpages;	/* number of total pages */
 	/* number of shadow or DAX exceptional entries */
 	unsigned long		nrexceptional;
+#ifdef CONFIG_READ_ONLY_THP_FOR_FS
+	/* number of thp, only for non-shmem files */
+	atomic_t		nr_thps;
+#endif
 	pgoff_t			writeback_index;/* writeback starts here */
 	const struct address_space_operations *a_ops;	/* methods */
 	unsigned long		flags;		/* error bits */
@@ -564,6 +574,41 @@ static inline void mapping_allow_writable(struct address_space *mapping)
 	atomic_inc(&mapping->i_mmap_writable);
 }
 
+/*
+ * Number of transparent hugepages in the page cache of a non-shmem file.
+ * Only tracked so that opening the file for write can shoot them down:
+ * huge pages in the regular-file page cache are strictly read-only.
+ */
+#ifdef CONFIG_READ_ONLY_THP_FOR_FS
+static inline int filemap_nr_thps(struct address_space *mapping)
+{
+	return atomic_read(&mapping->nr_thps);
+}
+
+static inline void filemap_nr_thps_inc(struct address_space *mapping)
+{
+	atomic_inc(&mapping->nr_thps);
+}
+
+static inline void filemap_nr_thps_dec(struct address_space *mapping)
+{
+	atomic_dec(&mapping->nr_thps);
+}
+#else
+static inline int filemap_nr_thps(struct address_space *mapping)
+{
+	return 0;
+}
+
+static inline void filemap_nr_thps_inc(struct address_space *mapping)
+{
+}
+
+static inline void filemap_nr_thps_dec(struct address_space *mapping)
+{
+}
+#endif
+
 /*
  * Use sequence counter to get consistent i_size on 32-bit processors.
  */
@@ -1329,6 +1374,22 @@ enum {
 
 #define SB_FREEZE_LEVELS (SB_FREEZE_COMPLETE - 1)
 
+/*
+ * The per-superblock inode list is sharded so that inode instantiation
+ * and eviction on different CPUs do not serialize on a single spinlock.
+ * An inode is assigned to a shard by hashing the inode, so it is always
+ * added to and removed from the same shard.  Walkers visit the shards
+ * one by one; there is no ordering between inodes on different shards.
+ */
+#define SB_INODES_SHARD_BITS	4
+#define SB_INODES_NR_SHARDS	(1 << SB_INODES_SHARD_BITS)
+
+struct sb_inodes_shard {
+	/* lock protects head and the i_sb_list linkage of its inodes */
+	spinlock_t		lock;
+	struct list_head	head;
+} ____cacheline_aligned_in_smp;
+
 struct sb_writers {
 	int				frozen;		/* Is sb frozen? */
 	wait_queue_head_t		wait_unfrozen;	/* for get_super_thawed() */
@@ -1434,6 +1495,10 @@ struct super_block {
 	struct rcu_head		rcu;
 	struct work_struct	destroy_work;
 
+	/* Unused negative dentries on s_dentry_lru, see fs/dcache.c */
+	atomic_long_t		s_nr_dentry_negative;
+	struct work_struct	s_neg_dentry_prune;
+
 	struct mutex		s_sync_lock;	/* sync serialisation lock */
 
 	/*
@@ -1441,14 +1506,27 @@ struct super_block {
 	 */
 	int s_stack_depth;
 
-	/* s_inode_list_lock protects s_inodes */
-	spinlock_t		s_inode_list_lock ____cacheline_aligned_in_smp;
-	struct list_head	s_inodes;	/* all inodes */
+	/* all inodes, sharded to avoid a single list lock */
+	struct sb_inodes_shard	s_inodes[SB_INODES_NR_SHARDS];
 
 	spinlock_t		s_inode_wblist_lock;
 	struct list_head	s_inodes_wb;	/* writeback inodes */
 };
 
+#define for_each_sb_inodes_shard(shard, sb)				\
+	for ((shard) = &(sb)->s_inodes[0];				\
+	     (shard) < &(sb)->s_inodes[SB_INODES_NR_SHARDS]; (shard)++)
+
+static inline bool sb_inodes_empty(struct super_block *sb)
+{
+	struct sb_inodes_shard *shard;
+
+	for_each_sb_inodes_shard(shard, sb)
+		if (!list_empty(&shard->head))
+			return false;
+	return true;
+}
+
 /* Helper functions so that in most cases filesystems will
  * not need to deal directly with kuid_t and kgid_t and can
  * instead deal with the raw numeric values that are stored
@@ -2538,6 +2616,8 @@ extern int filemap_fdatawait(struct address_space *);
 extern void filemap_fdatawait_keep_errors(struct address_space *);
 extern int filemap_fdatawait_range(struct address_space *, loff_t lstart,
 				   loff_t lend);
+extern bool filemap_range_has_page(struct address_space *mapping,
+				   loff_t start_byte, loff_t end_byte);
 extern int filemap_write_and_wait(struct address_space *mapping);
 extern int filemap_write_and_wait_range(struct address_space *mapping,
 				        loff_t lstart, loff_t lend);
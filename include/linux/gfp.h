@@ -433,6 +433,25 @@ __alloc_pages(gfp_t gfp_mask, unsigned int order,
 	return __alloc_pages_nodemask(gfp_mask, order, zonelist, NULL);
 }
 
+unsigned long
+__alloc_pages_bulk(gfp_t gfp_mask, struct zonelist *zonelist,
+		   nodemask_t *nodemask, int nr_pages,
+		   struct list_head *page_list);
+
+/*
+ * Allocate up to @nr_pages order-0 pages to @page_list, preferring
+ * the current CPU's closest node.  Returns the number allocated; the
+ * caller covers any shortfall through alloc_pages().  Release with
+ * free_hot_cold_page_list() or per-page __free_pages().
+ */
+static inline unsigned long
+alloc_pages_bulk(gfp_t gfp_mask, int nr_pages, struct list_head *page_list)
+{
+	return __alloc_pages_bulk(gfp_mask,
+				  node_zonelist(numa_mem_id(), gfp_mask),
+				  NULL, nr_pages, page_list);
+}
+
 /*
  * Allocate pages, preferring the node given as nid. The node must be valid and
  * online. For more general interface, see alloc_pages_node().
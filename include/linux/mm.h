@@ -1245,6 +1245,26 @@ int invalidate_inode_page(struct page *page);
 #ifdef CONFIG_MMU
 extern int handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 		unsigned int flags);
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+extern int handle_speculative_fault(struct mm_struct *mm,
+		unsigned long address, unsigned int flags);
+static inline void mm_seq_write_begin(struct mm_struct *mm)
+{
+	write_seqcount_begin(&mm->mm_seq);
+}
+static inline void mm_seq_write_end(struct mm_struct *mm)
+{
+	write_seqcount_end(&mm->mm_seq);
+}
+#else
+static inline int handle_speculative_fault(struct mm_struct *mm,
+		unsigned long address, unsigned int flags)
+{
+	return VM_FAULT_RETRY;
+}
+static inline void mm_seq_write_begin(struct mm_struct *mm) { }
+static inline void mm_seq_write_end(struct mm_struct *mm) { }
+#endif
 extern int fixup_user_fault(struct task_struct *tsk, struct mm_struct *mm,
 			    unsigned long address, unsigned int fault_flags,
 			    bool *unlocked);
@@ -8,6 +8,10 @@
 #include <linux/spinlock.h>
 #include <linux/rbtree.h>
 #include <linux/rwsem.h>
+#include <linux/seqlock.h>
+#ifdef CONFIG_VMA_RANGE_INDEX
+#include <linux/btree.h>
+#endif
 #include <linux/completion.h>
 #include <linux/cpumask.h>
 #include <linux/uprobes.h>
@@ -396,6 +400,21 @@ struct kioctx_table;
 struct mm_struct {
 	struct vm_area_struct *mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	/*
+	 * Bumped around every change to the VMA tree or to fields the
+	 * speculative fault path reads (vm_flags, vm_page_prot);
+	 * handle_speculative_fault() retries against it.
+	 */
+	seqcount_t mm_seq;
+#endif
+#ifdef CONFIG_VMA_RANGE_INDEX
+	struct btree_head vma_idx;	/* ~vm_end keyed VMA lookup index */
+	bool vma_idx_live;		/* cleared on allocation failure */
+#endif
+#ifdef CONFIG_PTABLE_AGING
+	struct list_head aging_list;	/* on the global aging round-robin */
+#endif
 	u32 vmacache_seqnum;                   /* per-thread vmacache */
 #ifdef CONFIG_MMU
 	unsigned long (*get_unmapped_area) (struct file *filp,
@@ -508,6 +527,10 @@ struct mm_struct {
 	bool tlb_flush_pending;
 #endif
 	struct uprobes_state uprobes_state;
+#ifdef CONFIG_SWAP
+	/* faulting address/window/hits of VMA based swap readahead */
+	atomic_long_t swap_readahead_info;
+#endif
 #ifdef CONFIG_X86_INTEL_MPX
 	/* address of the bounds directory */
 	void __user *bd_addr;
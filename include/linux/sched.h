@@ -63,6 +63,7 @@ struct sched_param {
 #include <asm/processor.h>
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
+#define SCHED_ATTR_SIZE_VER1	52	/* add: sched_latency_nice */
 
 /*
  * Extended scheduling parameters data structure.
@@ -124,6 +125,9 @@ struct sched_attr {
 	u64 sched_runtime;
 	u64 sched_deadline;
 	u64 sched_period;
+
+	/* Latency hint for SCHED_NORMAL (SCHED_FLAG_LATENCY_NICE) */
+	s32 sched_latency_nice;
 };
 
 struct futex_pi_state;
@@ -164,6 +168,11 @@ extern void get_avenrun(unsigned long *loads, unsigned long offset, int shift);
 	load += n*(FIXED_1-exp); \
 	load >>= FSHIFT;
 
+extern unsigned long calc_load(unsigned long load, unsigned long exp,
+			       unsigned long active);
+extern unsigned long calc_load_n(unsigned long load, unsigned long exp,
+				 unsigned long active, unsigned int n);
+
 extern unsigned long total_forks;
 extern int nr_threads;
 DECLARE_PER_CPU(unsigned long, process_counts);
@@ -1073,6 +1082,12 @@ struct sched_domain_shared {
 	atomic_t	ref;
 	atomic_t	nr_busy_cpus;
 	int		has_idle_cores;
+	/*
+	 * Rotating cursor for the bounded idle CPU scan; spreads
+	 * successive partial scans over the whole LLC instead of
+	 * rescanning the same CPUs from the same start point.
+	 */
+	int		idle_scan_cursor;
 };
 
 struct sched_domain {
@@ -1293,10 +1308,32 @@ struct load_weight {
  * Then it is the load_weight's responsibility to consider overflow
  * issues.
  */
+/*
+ * Estimation Utilization for FAIR tasks.
+ *
+ * Support data structure to track an Exponential Weighted Moving Average
+ * (EWMA) of a FAIR task's utilization. New samples are added to the moving
+ * average each time a task completes an activation. Sample's weight is
+ * chosen so that the EWMA will be relatively insensitive to transient
+ * changes to the task's workload.
+ *
+ * @enqueued: instantaneous estimated utilization of a task/cpu
+ *            task: the task's util_avg at last task dequeue time
+ *            cfs_rq: the sum of util_est.enqueued for each RUNNABLE task
+ * @ewma:     the exponential weighted moving average of a task's
+ *            utilization, dimensioned by its activations
+ */
+struct util_est {
+	unsigned int		enqueued;
+	unsigned int		ewma;
+#define UTIL_EST_WEIGHT_SHIFT	2
+};
+
 struct sched_avg {
 	u64 last_update_time, load_sum;
 	u32 util_sum, period_contrib;
 	unsigned long load_avg, util_avg;
+	struct util_est util_est;
 };
 
 #ifdef CONFIG_SCHEDSTATS
@@ -1501,6 +1538,11 @@ struct task_struct {
 	int on_rq;
 
 	int prio, static_prio, normal_prio;
+	int latency_nice;
+#ifdef CONFIG_PSI
+	/* Stalled due to lack of memory, IO or CPU - see psi_task_change() */
+	u32 psi_flags;
+#endif
 	unsigned int rt_priority;
 	const struct sched_class *sched_class;
 	struct sched_entity se;
@@ -1509,6 +1551,14 @@ struct task_struct {
 	struct task_group *sched_task_group;
 #endif
 	struct sched_dl_entity dl;
+#ifdef CONFIG_SCHED_SMT
+	/*
+	 * Tasks sharing a non-zero cookie may run concurrently on the
+	 * hardware threads of one core; a mismatch forces the sibling
+	 * idle.  Inherited across fork(), set via prctl().
+	 */
+	unsigned long core_cookie;
+#endif
 
 #ifdef CONFIG_PREEMPT_NOTIFIERS
 	/* list of struct preempt_notifier: */
@@ -1567,6 +1617,9 @@ struct task_struct {
 	unsigned sched_contributes_to_load:1;
 	unsigned sched_migrated:1;
 	unsigned sched_remote_wakeup:1;
+#ifdef CONFIG_PSI
+	unsigned sched_psi_wake_requeue:1;
+#endif
 	unsigned :0; /* force alignment to the next boundary */
 
 	/* unserialized, strictly 'current' */
@@ -1816,6 +1869,13 @@ struct task_struct {
 	int numa_scan_seq;
 	unsigned int numa_scan_period;
 	unsigned int numa_scan_period_max;
+	/*
+	 * Consecutive scan windows with predominantly local accesses;
+	 * once placement has converged, fault-driven scanning is parked
+	 * until the task migrates or its address space grows.
+	 */
+	unsigned int numa_scan_settled;
+	unsigned long numa_scan_settled_rss;
 	int numa_preferred_nid;
 	unsigned long numa_migrate_retry;
 	u64 node_stamp;			/* migration stamp  */
@@ -2276,6 +2336,7 @@ extern void thread_group_cputime_adjusted(struct task_struct *p, cputime_t *ut,
 #define PF_KTHREAD	0x00200000	/* I am a kernel thread */
 #define PF_RANDOMIZE	0x00400000	/* randomize virtual address space */
 #define PF_SWAPWRITE	0x00800000	/* Allowed to write to swap */
+#define PF_MEMSTALL	0x01000000	/* Stalled due to lack of memory */
 #define PF_NO_SETAFFINITY 0x04000000	/* Userland is not allowed to meddle with cpus_allowed */
 #define PF_MCE_EARLY    0x08000000      /* Early kill for mce process policy */
 #define PF_MUTEX_TESTER	0x20000000	/* Thread belongs to the rt mutex tester */
@@ -2602,6 +2663,20 @@ extern int sched_setscheduler_nocheck(struct task_struct *, int,
 				      const struct sched_param *);
 extern int sched_setattr(struct task_struct *,
 			 const struct sched_attr *);
+#ifdef CONFIG_SCHED_SMT
+extern int sched_core_set_cookie(struct task_struct *p, unsigned long cookie);
+extern unsigned long sched_core_get_cookie(struct task_struct *p);
+#else
+static inline int sched_core_set_cookie(struct task_struct *p,
+					unsigned long cookie)
+{
+	return -EINVAL;
+}
+static inline unsigned long sched_core_get_cookie(struct task_struct *p)
+{
+	return 0;
+}
+#endif
 extern struct task_struct *idle_task(int cpu);
 /**
  * is_idle_task - is the specified task an idle task?
@@ -2587,9 +2587,17 @@ static inline void skb_frag_ref(struct sk_buff *skb, int f)
  *
  * Releases a reference on the paged fragment @frag.
  */
+bool page_pool_return_skb_page(struct page *page);
+
 static inline void __skb_frag_unref(skb_frag_t *frag)
 {
-	put_page(skb_frag_page(frag));
+	struct page *page = skb_frag_page(frag);
+
+	/* Exclusively held page_pool pages flow back to their pool */
+	if (IS_ENABLED(CONFIG_PAGE_POOL) && page_pool_return_skb_page(page))
+		return;
+
+	put_page(page);
 }
 
 /**
@@ -341,6 +341,41 @@ void kmem_cache_free(struct kmem_cache *, void *);
 void kmem_cache_free_bulk(struct kmem_cache *, size_t, void **);
 int kmem_cache_alloc_bulk(struct kmem_cache *, gfp_t, size_t, void **);
 
+/*
+ * Opt in to a small per-cpu LIFO of objects in front of the regular
+ * alloc/free paths, refilled and flushed in bulk, for caches with
+ * bursty alloc/free patterns.  Only implemented by SLUB; elsewhere it
+ * is a no-op and the cache works as before.
+ */
+#ifdef CONFIG_SLUB
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count);
+#else
+static inline int kmem_cache_setup_percpu_array(struct kmem_cache *s,
+						unsigned int count)
+{
+	return 0;
+}
+#endif
+
+/*
+ * Opt in to per-cpu batching of frees to remote-node slabs: instead of
+ * pushing each object back onto its home slab immediately (bouncing
+ * the slab freelist cacheline across nodes), up to @count objects per
+ * cpu accumulate locally and are flushed to the owning node in bulk.
+ * Only implemented by SLUB; elsewhere it is a no-op.  Not suitable for
+ * caches whose users rely on frees taking effect immediately (e.g.
+ * SLAB_DESTROY_BY_RCU caches that count outstanding objects).
+ */
+#ifdef CONFIG_SLUB
+int kmem_cache_setup_remote_free(struct kmem_cache *s, unsigned int count);
+#else
+static inline int kmem_cache_setup_remote_free(struct kmem_cache *s,
+					       unsigned int count)
+{
+	return 0;
+}
+#endif
+
 /*
  * Caller must not use kfree_bulk() on memory not originally allocated
  * by kmalloc(), because the SLOB allocator cannot handle this.
@@ -56,11 +56,25 @@ struct kmem_cache_order_objects {
 	unsigned long x;
 };
 
+/*
+ * Optional per-cpu array front end for burst alloc/free, see
+ * kmem_cache_setup_percpu_array().  Defined in mm/slub.c.
+ */
+struct kmem_cache_cpu_array;
+
+/*
+ * Optional per-cpu batching queue for frees to remote-node slabs, see
+ * kmem_cache_setup_remote_free().  Defined in mm/slub.c.
+ */
+struct kmem_cache_remote_free;
+
 /*
  * Slab cache management.
  */
 struct kmem_cache {
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	struct kmem_cache_cpu_array __percpu *cpu_array;
+	struct kmem_cache_remote_free __percpu *remote_free;
 	/* Used for retriving partial slabs etc */
 	unsigned long flags;
 	unsigned long min_partial;
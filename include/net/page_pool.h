@@ -0,0 +1,101 @@
+/*
+ * page_pool.h
+ *	Generic recycling allocator for DMA-mapped RX pages.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+
+/*
+ * A page_pool is a fast-path allocator for drivers that consume pages
+ * at packet rate.  Pages stay DMA-mapped for the life of the pool and
+ * are recycled through two tiers:
+ *
+ *  - an array cache, touched only from the pool's NAPI/softirq
+ *    context, so it needs no locking at all;
+ *  - a ptr_ring, fed from any context (e.g. skb freeing on another
+ *    CPU) and drained into the cache by the softirq side.
+ *
+ * Only when both tiers fail does the pool fall back to the page
+ * allocator, and only pages leaving the pool get DMA-unmapped.
+ */
+#ifndef _NET_PAGE_POOL_H
+#define _NET_PAGE_POOL_H
+
+#include <linux/mm.h>
+#include <linux/ptr_ring.h>
+#include <linux/dma-direction.h>
+#include <linux/poison.h>
+
+/* Keep pages DMA-mapped with params.dma_dir while owned by the pool */
+#define PP_FLAG_DMA_MAP		BIT(0)
+#define PP_FLAG_ALL		(PP_FLAG_DMA_MAP)
+
+/*
+ * Pool-owned pages are tagged through the otherwise unused lru.next
+ * field; poison-based so that a stale pointer in a foreign page
+ * cannot alias it.
+ */
+#define PP_SIGNATURE		(0x40 + POISON_POINTER_DELTA)
+
+#define PP_ALLOC_CACHE_SIZE	128
+#define PP_ALLOC_CACHE_REFILL	64
+
+struct page_pool_params {
+	unsigned int	flags;
+	unsigned int	order;
+	unsigned int	pool_size;	/* ptr_ring size, power of 2 */
+	int		nid;
+	struct device	*dev;		/* for DMA mapping */
+	enum dma_data_direction dma_dir;
+};
+
+struct page_pool {
+	struct page_pool_params p;
+
+	/* NAPI-context-only tier, no locking */
+	struct {
+		u32 count;
+		struct page *cache[PP_ALLOC_CACHE_SIZE];
+	} alloc;
+
+	/* Any-context return tier */
+	struct ptr_ring ring;
+
+	/* Pages handed out and not yet returned or released */
+	atomic_t pages_in_flight;
+	bool destroyed;
+	struct delayed_work release_dw;
+};
+
+struct page_pool *page_pool_create(const struct page_pool_params *params);
+void page_pool_destroy(struct page_pool *pool);
+
+struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp);
+
+static inline struct page *page_pool_dev_alloc_pages(struct page_pool *pool)
+{
+	return page_pool_alloc_pages(pool, GFP_ATOMIC | __GFP_NOWARN);
+}
+
+/*
+ * Return a page to its pool.  @allow_direct may only be true from the
+ * pool's NAPI context (it targets the lockless cache).
+ */
+void page_pool_put_page(struct page_pool *pool, struct page *page,
+			bool allow_direct);
+
+/* Unmap and sever a page from the pool without freeing it */
+void page_pool_release_page(struct page_pool *pool, struct page *page);
+
+static inline dma_addr_t page_pool_get_dma_addr(struct page *page)
+{
+	return (dma_addr_t)page_private(page);
+}
+
+/* Hook for the skb frag unref path, see __skb_frag_unref() */
+bool page_pool_return_skb_page(struct page *page);
+
+#endif /* _NET_PAGE_POOL_H */
@@ -79,8 +79,9 @@ struct io_event {
 struct iocb {
 	/* these are internal to the kernel/libc. */
 	__u64	aio_data;	/* data to be returned in event's data */
-	__u32	PADDED(aio_key, aio_reserved1);
-				/* the kernel sets aio_key to the req # */
+	__u32	PADDED(aio_key, aio_rw_flags);
+				/* the kernel sets aio_key to the req #,
+				 * aio_rw_flags takes RWF_* flags */
 
 	/* common fields */
 	__u16	aio_lio_opcode;	/* see IOCB_CMD_ above */
@@ -18,4 +18,11 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/*
+ * Like POSIX_FADV_WILLNEED, but the readahead is submitted from a
+ * workqueue and the call returns immediately; progress can be observed
+ * through mincore() as the pages enter the page cache.
+ */
+#define POSIX_FADV_WILLNEED_ASYNC	8 /* Will need, don't block.  */
+
 #endif	/* FADVISE_H_INCLUDED */
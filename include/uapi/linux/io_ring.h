@@ -0,0 +1,97 @@
+#ifndef _UAPI_LINUX_IO_RING_H
+#define _UAPI_LINUX_IO_RING_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Ring-based asynchronous I/O interface, exposed through /dev/io_ring.
+ *
+ * After opening the device, IO_RING_IOC_SETUP sizes the rings and the
+ * three regions below are mmap'd using the IO_RING_OFF_* offsets.  The
+ * application fills struct io_ring_sqe slots at sq tail, publishes them
+ * by advancing the tail, and calls IO_RING_IOC_ENTER to have the kernel
+ * consume them.  Completions appear as struct io_ring_cqe at cq tail.
+ */
+
+struct io_ring_sqe {
+	__u8	opcode;		/* IO_RING_OP_* */
+	__u8	flags;		/* none defined yet, must be 0 */
+	__u16	__pad1;
+	__s32	fd;		/* file descriptor to do IO on */
+	__u64	off;		/* file offset */
+	__u64	addr;		/* buffer address */
+	__u32	len;		/* buffer length */
+	__u32	rw_flags;	/* op specific, e.g. IO_RING_FSYNC_* */
+	__u64	user_data;	/* returned untouched in the cqe */
+	__u64	__pad2[3];
+};
+
+enum {
+	IO_RING_OP_NOP,
+	IO_RING_OP_READ,
+	IO_RING_OP_WRITE,
+	IO_RING_OP_FSYNC,
+
+	IO_RING_OP_LAST,	/* not a real opcode */
+};
+
+/* sqe->rw_flags for IO_RING_OP_FSYNC */
+#define IO_RING_FSYNC_DATASYNC	(1U << 0)
+
+struct io_ring_cqe {
+	__u64	user_data;	/* sqe->user_data of this request */
+	__s32	res;		/* result code (byte count or -errno) */
+	__u32	__pad;
+};
+
+/*
+ * Shared submission queue header.  The kernel consumes entries at head,
+ * the application produces them at tail; both indices are free running
+ * and are masked with ring_mask to index the sqe array.
+ */
+struct io_ring_sq {
+	__u32	head;
+	__u32	tail;
+	__u32	ring_mask;
+	__u32	ring_entries;
+	__u32	dropped;	/* sqes dropped due to invalid contents */
+};
+
+/*
+ * Shared completion queue.  The kernel produces entries at tail, the
+ * application consumes them at head.
+ */
+struct io_ring_cq {
+	__u32	head;
+	__u32	tail;
+	__u32	ring_mask;
+	__u32	ring_entries;
+	__u32	overflow;	/* completions dropped on a full ring */
+	__u32	__pad;
+	struct io_ring_cqe cqes[];
+};
+
+/* mmap offsets for the shared regions */
+#define IO_RING_OFF_SQ_RING	0ULL
+#define IO_RING_OFF_CQ_RING	0x8000000ULL
+#define IO_RING_OFF_SQES	0x10000000ULL
+
+struct io_ring_params {
+	__u32	sq_entries;	/* in: wanted, out: rounded up */
+	__u32	cq_entries;	/* out: always 2 * sq_entries */
+	__u32	flags;		/* none defined yet, must be 0 */
+	__u32	resv[5];
+};
+
+struct io_ring_enter {
+	__u32	to_submit;	/* max sqes to consume */
+	__u32	min_complete;	/* wait for this many available cqes */
+	__u32	flags;		/* none defined yet, must be 0 */
+	__u32	resv;
+};
+
+#define IO_RING_IOC_SETUP	_IOWR('O', 0x70, struct io_ring_params)
+#define IO_RING_IOC_ENTER	_IOWR('O', 0x71, struct io_ring_enter)
+
+#endif /* _UAPI_LINUX_IO_RING_H */
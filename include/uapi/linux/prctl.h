@@ -197,4 +197,8 @@ struct prctl_mm_map {
 # define PR_CAP_AMBIENT_LOWER		3
 # define PR_CAP_AMBIENT_CLEAR_ALL	4
 
+/* Tag the task with a core scheduling cookie (0 clears the tag) */
+#define PR_SET_CORE_COOKIE		48
+#define PR_GET_CORE_COOKIE		49
+
 #endif /* _LINUX_PRCTL_H */
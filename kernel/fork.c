@@ -19,6 +19,7 @@
 #include <linux/completion.h>
 #include <linux/personality.h>
 #include <linux/mempolicy.h>
+#include <linux/btree.h>
 #include <linux/sem.h>
 #include <linux/file.h>
 #include <linux/fdtable.h>
@@ -183,6 +184,9 @@ static unsigned long *alloc_thread_stack_node(struct task_struct *tsk, int node)
 			continue;
 		this_cpu_write(cached_stacks[i], NULL);
 
+		/* Clear stale pointers from reused stack. */
+		memset(s->addr, 0, THREAD_SIZE);
+
 		tsk->stack_vm_area = s;
 		local_irq_enable();
 		return s->addr;
@@ -749,6 +753,12 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 {
 	mm->mmap = NULL;
 	mm->mm_rb = RB_ROOT;
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	seqcount_init(&mm->mm_seq);
+#endif
+#ifdef CONFIG_VMA_RANGE_INDEX
+	mm->vma_idx_live = !btree_init(&mm->vma_idx);
+#endif
 	mm->vmacache_seqnum = 0;
 	atomic_set(&mm->mm_users, 1);
 	atomic_set(&mm->mm_count, 1);
@@ -767,6 +777,9 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 	mm_init_owner(mm, p);
 	mmu_notifier_mm_init(mm);
 	clear_tlb_flush_pending(mm);
+#ifdef CONFIG_SWAP
+	atomic_long_set(&mm->swap_readahead_info, 0);
+#endif
 #if defined(CONFIG_TRANSPARENT_HUGEPAGE) && !USE_SPLIT_PMD_PTLOCKS
 	mm->pmd_huge_pte = NULL;
 #endif
@@ -785,6 +798,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p)
 	if (init_new_context(p, mm))
 		goto fail_nocontext;
 
+	ptaging_mm_add(mm);
 	return mm;
 
 fail_nocontext:
@@ -841,6 +855,12 @@ struct mm_struct *mm_alloc(void)
 void __mmdrop(struct mm_struct *mm)
 {
 	BUG_ON(mm == &init_mm);
+	ptaging_mm_del(mm);
+#ifdef CONFIG_VMA_RANGE_INDEX
+	/* exit_mmap() doesn't bother erasing entries one by one */
+	btree_grim_visitor(&mm->vma_idx, &btree_geo32, 0, NULL, NULL);
+	btree_destroy(&mm->vma_idx);
+#endif
 	mm_free_pgd(mm);
 	destroy_context(mm);
 	mmu_notifier_mm_destroy(mm);
@@ -2085,7 +2105,15 @@ void __init proc_caches_init(void)
 			sizeof(struct mm_struct), ARCH_MIN_MMSTRUCT_ALIGN,
 			SLAB_HWCACHE_ALIGN|SLAB_PANIC|SLAB_NOTRACK|SLAB_ACCOUNT,
 			NULL);
-	vm_area_cachep = KMEM_CACHE(vm_area_struct, SLAB_PANIC|SLAB_ACCOUNT);
+	/*
+	 * With speculative page faults, VMAs are walked under RCU;
+	 * SLAB_DESTROY_BY_RCU keeps the memory type stable so a stale
+	 * pointer dereferences a (possibly recycled) vm_area_struct,
+	 * never unrelated memory.  Reuse is caught by the mm_seq check.
+	 */
+	vm_area_cachep = KMEM_CACHE(vm_area_struct, SLAB_PANIC|SLAB_ACCOUNT|
+			(IS_ENABLED(CONFIG_SPECULATIVE_PAGE_FAULT) ?
+			 SLAB_DESTROY_BY_RCU : 0));
 	mmap_init();
 	nsproxy_cache_init();
 }
@@ -425,6 +425,9 @@ static bool set_nr_if_polling(struct task_struct *p)
 #endif
 #endif
 
+static int try_to_wake_up(struct task_struct *p, unsigned int state,
+			  int wake_flags);
+
 void wake_q_add(struct wake_q_head *head, struct task_struct *task)
 {
 	struct wake_q_node *node = &task->wake_q;
@@ -463,10 +466,14 @@ void wake_up_q(struct wake_q_head *head)
 		task->wake_q.next = NULL;
 
 		/*
-		 * wake_up_process() implies a wmb() to pair with the queueing
+		 * try_to_wake_up() implies a wmb() to pair with the queueing
 		 * in wake_q_add() so as not to miss wakeups.
+		 *
+		 * Mass wakeups (futex broadcasts, rwsem wake lists) ask for
+		 * WF_QUEUE so all tasks bound for the same CPU are batched
+		 * onto its wake_list with a single IPI - see ttwu_queue().
 		 */
-		wake_up_process(task);
+		try_to_wake_up(task, TASK_NORMAL, WF_QUEUE);
 		put_task_struct(task);
 	}
 }
@@ -755,16 +762,20 @@ static void set_load_weight(struct task_struct *p)
 static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
-	if (!(flags & ENQUEUE_RESTORE))
+	if (!(flags & ENQUEUE_RESTORE)) {
 		sched_info_queued(rq, p);
+		psi_enqueue(p, flags & ENQUEUE_WAKEUP);
+	}
 	p->sched_class->enqueue_task(rq, p, flags);
 }
 
 static inline void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	update_rq_clock(rq);
-	if (!(flags & DEQUEUE_SAVE))
+	if (!(flags & DEQUEUE_SAVE)) {
 		sched_info_dequeued(rq, p);
+		psi_dequeue(p, flags & DEQUEUE_SLEEP);
+	}
 	p->sched_class->dequeue_task(rq, p, flags);
 }
 
@@ -1884,7 +1895,16 @@ static void ttwu_queue(struct task_struct *p, int cpu, int wake_flags)
 	struct pin_cookie cookie;
 
 #if defined(CONFIG_SMP)
-	if (sched_feat(TTWU_QUEUE) && !cpus_share_cache(smp_processor_id(), cpu)) {
+	/*
+	 * WF_QUEUE wakeups come from mass-wakeup sites like wake_up_q():
+	 * defer even cache-affine targets to the remote CPU, so that all
+	 * tasks heading to one CPU are enqueued under a single rq lock
+	 * acquisition and at most one IPI (llist_add() only fires the
+	 * IPI for the first pending entry).
+	 */
+	if (sched_feat(TTWU_QUEUE) && cpu != smp_processor_id() &&
+	    ((wake_flags & WF_QUEUE) ||
+	     !cpus_share_cache(smp_processor_id(), cpu))) {
 		sched_clock_cpu(cpu); /* sync clocks x-cpu */
 		ttwu_queue_remote(p, cpu, wake_flags);
 		return;
@@ -2088,6 +2108,7 @@ try_to_wake_up(struct task_struct *p, unsigned int state, int wake_flags)
 	cpu = select_task_rq(p, p->wake_cpu, SD_BALANCE_WAKE, wake_flags);
 	if (task_cpu(p) != cpu) {
 		wake_flags |= WF_MIGRATED;
+		psi_ttwu_dequeue(p);
 		set_task_cpu(p, cpu);
 	}
 #endif /* CONFIG_SMP */
@@ -2243,6 +2264,8 @@ static void __sched_fork(unsigned long clone_flags, struct task_struct *p)
 	p->node_stamp = 0ULL;
 	p->numa_scan_seq = p->mm ? p->mm->numa_scan_seq : 0;
 	p->numa_scan_period = sysctl_numa_balancing_scan_delay;
+	p->numa_scan_settled = 0;
+	p->numa_scan_settled_rss = 0;
 	p->numa_work.next = &p->numa_work;
 	p->numa_faults = NULL;
 	p->last_task_numa_placement = 0;
@@ -2396,6 +2419,7 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 		} else if (PRIO_TO_NICE(p->static_prio) < 0)
 			p->static_prio = NICE_TO_PRIO(0);
 
+		p->latency_nice = 0;
 		p->prio = p->normal_prio = __normal_prio(p);
 		set_load_weight(p);
 
@@ -3252,6 +3276,121 @@ static inline void schedule_debug(struct task_struct *prev)
 	schedstat_inc(this_rq()->sched_count);
 }
 
+#ifdef CONFIG_SCHED_SMT
+/* Enabled once the first task tags itself with a cookie, never cleared. */
+DEFINE_STATIC_KEY_FALSE(__sched_core_enabled);
+
+/*
+ * Can @p share a core with whatever is currently running on the SMT
+ * siblings of this_rq?  The siblings' ->curr is read without their rq
+ * lock, so enforcement is best effort with respect to concurrent
+ * context switches; sched_core_switch() reschedules the siblings on
+ * every cookie transition to close the window.
+ *
+ * When two cookies collide the task on the lower numbered CPU wins, so
+ * that exactly one side yields and the core cannot go fully idle.
+ */
+static bool core_cookie_match(struct rq *rq, struct task_struct *p)
+{
+	int cpu, this_cpu = cpu_of(rq);
+	struct task_struct *curr;
+
+	for_each_cpu(cpu, cpu_smt_mask(this_cpu)) {
+		if (cpu == this_cpu)
+			continue;
+
+		curr = READ_ONCE(cpu_rq(cpu)->curr);
+		if (is_idle_task(curr) || !curr->core_cookie)
+			continue;
+		if (curr->core_cookie == p->core_cookie)
+			continue;
+		if (!p->core_cookie || cpu < this_cpu)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Called from __schedule() with rq->lock held whenever the cookie of
+ * the running task changes; kick the siblings so they re-evaluate
+ * their pick.  The siblings' TIF_NEED_RESCHED is set locklessly: worst
+ * case a freshly switched-in task eats one spurious reschedule.
+ */
+static void sched_core_switch(struct rq *rq, struct task_struct *prev,
+			      struct task_struct *next)
+{
+	int cpu, this_cpu = cpu_of(rq);
+
+	if (!static_branch_unlikely(&__sched_core_enabled))
+		return;
+
+	if (prev->core_cookie == next->core_cookie)
+		return;
+
+	for_each_cpu(cpu, cpu_smt_mask(this_cpu)) {
+		if (cpu == this_cpu)
+			continue;
+
+		set_tsk_need_resched(READ_ONCE(cpu_rq(cpu)->curr));
+		smp_send_reschedule(cpu);
+	}
+}
+
+int sched_core_set_cookie(struct task_struct *p, unsigned long cookie)
+{
+	if (!static_branch_likely(&sched_smt_present))
+		return -EOPNOTSUPP;
+
+	WRITE_ONCE(p->core_cookie, cookie);
+	if (cookie)
+		static_branch_enable(&__sched_core_enabled);
+
+	/* Make the new constraint visible to the siblings. */
+	set_tsk_need_resched(p);
+
+	return 0;
+}
+
+unsigned long sched_core_get_cookie(struct task_struct *p)
+{
+	return READ_ONCE(p->core_cookie);
+}
+
+/*
+ * If the freshly picked task may not share the core, put it back and
+ * force this sibling idle instead.  The rq stays "busy" (nr_running is
+ * unchanged), so a cookie transition on the sibling brings us back.
+ */
+static struct task_struct *
+sched_core_gate(struct rq *rq, struct task_struct *p)
+{
+	if (!static_branch_unlikely(&__sched_core_enabled))
+		return p;
+
+	/*
+	 * Never gate an inactive CPU: migrate_tasks() relies on
+	 * pick_next_task() draining the rq during hotplug.
+	 */
+	if (p == rq->idle || !cpu_active(cpu_of(rq)) || core_cookie_match(rq, p))
+		return p;
+
+	put_prev_task(rq, p);
+	update_idle_core(rq);
+	schedstat_inc(rq->sched_goidle);
+
+	return rq->idle;
+}
+#else /* !CONFIG_SCHED_SMT */
+static inline void sched_core_switch(struct rq *rq, struct task_struct *prev,
+				     struct task_struct *next) { }
+static inline struct task_struct *
+sched_core_gate(struct rq *rq, struct task_struct *p)
+{
+	return p;
+}
+#endif /* CONFIG_SCHED_SMT */
+
 /*
  * Pick up the highest-prio task:
  */
@@ -3275,7 +3414,7 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct pin_cookie cookie
 		if (unlikely(!p))
 			p = idle_sched_class.pick_next_task(rq, prev, cookie);
 
-		return p;
+		return sched_core_gate(rq, p);
 	}
 
 again:
@@ -3284,7 +3423,7 @@ again:
 		if (p) {
 			if (unlikely(p == RETRY_TASK))
 				goto again;
-			return p;
+			return sched_core_gate(rq, p);
 		}
 	}
 
@@ -3389,6 +3528,7 @@ static void __sched notrace __schedule(bool preempt)
 		update_rq_clock(rq);
 
 	next = pick_next_task(rq, prev, cookie);
+	sched_core_switch(rq, prev, next);
 	clear_tsk_need_resched(prev);
 	clear_preempt_need_resched();
 	rq->clock_skip_update = 0;
@@ -3954,6 +4094,9 @@ static void __setscheduler_params(struct task_struct *p,
 	else if (fair_policy(policy))
 		p->static_prio = NICE_TO_PRIO(attr->sched_nice);
 
+	if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE)
+		p->latency_nice = attr->sched_latency_nice;
+
 	/*
 	 * __sched_setscheduler() ensures attr->sched_priority == 0 when
 	 * !rt_policy. Always setting this ensures that things like
@@ -4098,9 +4241,25 @@ recheck:
 			return -EINVAL;
 	}
 
-	if (attr->sched_flags & ~(SCHED_FLAG_RESET_ON_FORK))
+	if (attr->sched_flags & ~(SCHED_FLAG_RESET_ON_FORK |
+				  SCHED_FLAG_LATENCY_NICE |
+				  SCHED_FLAG_RECLAIM))
 		return -EINVAL;
 
+	/* Only -deadline tasks can reclaim unused bandwidth */
+	if ((attr->sched_flags & SCHED_FLAG_RECLAIM) && !dl_policy(policy))
+		return -EINVAL;
+
+	if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE) {
+		if (attr->sched_latency_nice > MAX_NICE ||
+		    attr->sched_latency_nice < MIN_NICE)
+			return -EINVAL;
+		/* Use the same security checks as NICE */
+		if (user && !capable(CAP_SYS_NICE) &&
+		    attr->sched_latency_nice < p->latency_nice)
+			return -EPERM;
+	}
+
 	/*
 	 * Valid priorities for SCHED_FIFO and SCHED_RR are
 	 * 1..MAX_USER_RT_PRIO-1, valid priority for SCHED_NORMAL,
@@ -4194,6 +4353,9 @@ recheck:
 	if (unlikely(policy == p->policy)) {
 		if (fair_policy(policy) && attr->sched_nice != task_nice(p))
 			goto change;
+		if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+		    attr->sched_latency_nice != p->latency_nice)
+			goto change;
 		if (rt_policy(policy) && attr->sched_priority != p->rt_priority)
 			goto change;
 		if (dl_policy(policy) && dl_param_changed(p, attr))
@@ -4455,6 +4617,10 @@ static int sched_copy_attr(struct sched_attr __user *uattr,
 	 */
 	attr->sched_nice = clamp(attr->sched_nice, MIN_NICE, MAX_NICE);
 
+	/* The latency hint uses the same range as the nice value. */
+	attr->sched_latency_nice = clamp(attr->sched_latency_nice,
+					 MIN_NICE, MAX_NICE);
+
 	return 0;
 
 err_size:
@@ -4672,6 +4838,8 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 	else
 		attr.sched_nice = task_nice(p);
 
+	attr.sched_latency_nice = p->latency_nice;
+
 	rcu_read_unlock();
 
 	retval = sched_read_attr(uattr, &attr, size);
@@ -7692,6 +7860,8 @@ void __init sched_init(void)
 
 	init_schedstats();
 
+	psi_init();
+
 	scheduler_running = 1;
 }
 
@@ -8784,6 +8954,132 @@ static struct cftype cpu_files[] = {
 	{ }	/* terminate */
 };
 
+static int cpu_stat_show_dfl(struct seq_file *sf, void *v)
+{
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		struct task_group *tg = css_tg(seq_css(sf));
+		struct cfs_bandwidth *cfs_b = &tg->cfs_bandwidth;
+
+		seq_printf(sf, "nr_periods %d\n", cfs_b->nr_periods);
+		seq_printf(sf, "nr_throttled %d\n", cfs_b->nr_throttled);
+		seq_printf(sf, "throttled_usec %llu\n",
+			   cfs_b->throttled_time / NSEC_PER_USEC);
+	}
+#endif
+	return 0;
+}
+
+#ifdef CONFIG_FAIR_GROUP_SCHED
+static u64 cpu_weight_read_u64(struct cgroup_subsys_state *css,
+			       struct cftype *cft)
+{
+	struct task_group *tg = css_tg(css);
+	u64 weight = scale_load_down(tg->shares);
+
+	return DIV_ROUND_CLOSEST_ULL(weight * CGROUP_WEIGHT_DFL, 1024);
+}
+
+static int cpu_weight_write_u64(struct cgroup_subsys_state *css,
+				struct cftype *cft, u64 weight)
+{
+	/*
+	 * cgroup weight knobs should use the common MIN, DFL and MAX
+	 * values which are 1, 100 and 10000 respectively.  While it loses
+	 * a bit of range on both ends, it maps pretty well onto the shares
+	 * value used by scheduler and the round-trip conversions preserve
+	 * the original value over the entire range.
+	 */
+	if (weight < CGROUP_WEIGHT_MIN || weight > CGROUP_WEIGHT_MAX)
+		return -ERANGE;
+
+	weight = DIV_ROUND_CLOSEST_ULL(weight * 1024, CGROUP_WEIGHT_DFL);
+
+	return sched_group_set_shares(css_tg(css), scale_load(weight));
+}
+#endif
+
+static void __maybe_unused cpu_period_quota_print(struct seq_file *sf,
+						  long period, long quota)
+{
+	if (quota < 0)
+		seq_puts(sf, "max");
+	else
+		seq_printf(sf, "%ld", quota);
+
+	seq_printf(sf, " %ld\n", period);
+}
+
+/* caller should put the current value in *@periodp before calling */
+static int __maybe_unused cpu_period_quota_parse(char *buf,
+						 u64 *periodp, u64 *quotap)
+{
+	char tok[21];	/* U64_MAX */
+
+	if (!sscanf(buf, "%20s %llu", tok, periodp))
+		return -EINVAL;
+
+	*periodp *= NSEC_PER_USEC;
+
+	if (sscanf(tok, "%llu", quotap))
+		*quotap *= NSEC_PER_USEC;
+	else if (!strcmp(tok, "max"))
+		*quotap = RUNTIME_INF;
+	else
+		return -EINVAL;
+
+	return 0;
+}
+
+#ifdef CONFIG_CFS_BANDWIDTH
+static int cpu_max_show(struct seq_file *sf, void *v)
+{
+	struct task_group *tg = css_tg(seq_css(sf));
+
+	cpu_period_quota_print(sf, tg_get_cfs_period(tg), tg_get_cfs_quota(tg));
+	return 0;
+}
+
+static ssize_t cpu_max_write(struct kernfs_open_file *of,
+			     char *buf, size_t nbytes, loff_t off)
+{
+	struct task_group *tg = css_tg(of_css(of));
+	u64 period = tg_get_cfs_period(tg) * NSEC_PER_USEC;
+	u64 quota;
+	int ret;
+
+	ret = cpu_period_quota_parse(buf, &period, &quota);
+	if (!ret)
+		ret = tg_set_cfs_bandwidth(tg, period, quota);
+	return ret ?: nbytes;
+}
+#endif
+
+static struct cftype cpu_files_dfl[] = {
+	{
+		.name = "stat",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_stat_show_dfl,
+	},
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	{
+		.name = "weight",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.read_u64 = cpu_weight_read_u64,
+		.write_u64 = cpu_weight_write_u64,
+	},
+#endif
+#ifdef CONFIG_CFS_BANDWIDTH
+	{
+		.name = "max",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = cpu_max_show,
+		.write = cpu_max_write,
+	},
+#endif
+	{ }	/* terminate */
+};
+
 struct cgroup_subsys cpu_cgrp_subsys = {
 	.css_alloc	= cpu_cgroup_css_alloc,
 	.css_released	= cpu_cgroup_css_released,
@@ -8792,6 +9088,7 @@ struct cgroup_subsys cpu_cgrp_subsys = {
 	.can_attach	= cpu_cgroup_can_attach,
 	.attach		= cpu_cgroup_attach,
 	.legacy_cftypes	= cpu_files,
+	.dfl_cftypes	= cpu_files_dfl,
 	.early_init	= true,
 };
 
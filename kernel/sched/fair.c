@@ -22,6 +22,7 @@
 
 #include <linux/sched.h>
 #include <linux/latencytop.h>
+#include <linux/mm.h>
 #include <linux/cpumask.h>
 #include <linux/cpuidle.h>
 #include <linux/slab.h>
@@ -1287,6 +1288,15 @@ bool should_numa_migrate_memory(struct task_struct *p, struct page * page,
 
 	this_cpupid = cpu_pid_to_cpupid(dst_cpu, current->pid);
 
+	/*
+	 * With reclaim-driven demotion enabled, CPU-less nodes hold the
+	 * cold tier; pages there that see a fault at all are worth
+	 * promoting without waiting for the two-reference filter below,
+	 * which would starve pages whose accesses are sampled rarely.
+	 */
+	if (numa_demotion_enabled && !node_state(src_nid, N_CPU))
+		return true;
+
 	/*
 	 * Multi-stage node selection is used in conjunction with a periodic
 	 * migration fault to build a temporal task<->page relation. By using
@@ -1769,6 +1779,7 @@ static int task_numa_migrate(struct task_struct *p)
 	 * alternative node to recheck if the tasks is now properly placed.
 	 */
 	p->numa_scan_period = task_scan_min(p);
+	numa_scan_unsettle(p);
 
 	if (env.best_task == NULL) {
 		ret = migrate_task_to(p, env.best_cpu);
@@ -1842,6 +1853,27 @@ static void numa_group_count_active_nodes(struct numa_group *numa_group)
 #define NUMA_PERIOD_SLOTS 10
 #define NUMA_PERIOD_THRESHOLD 7
 
+/*
+ * Once at least NUMA_SCAN_SETTLE_RATIO of the hinting faults in a scan
+ * window are local for NUMA_SCAN_SETTLE_COUNT consecutive windows,
+ * placement has converged and fault-driven scanning is parked entirely.
+ * It is restarted when the task runs off its preferred node or when the
+ * address space has grown by more than 1/8th since convergence.
+ */
+#define NUMA_SCAN_SETTLE_RATIO 9
+#define NUMA_SCAN_SETTLE_COUNT 3
+
+static bool numa_scan_settled(struct task_struct *p)
+{
+	return p->numa_scan_settled >= NUMA_SCAN_SETTLE_COUNT;
+}
+
+static void numa_scan_unsettle(struct task_struct *p)
+{
+	p->numa_scan_settled = 0;
+	p->numa_scan_settled_rss = 0;
+}
+
 /*
  * Increase the scan period (slow down scanning) if the majority of
  * our memory is already on our local node, or if the majority of
@@ -1883,6 +1915,24 @@ static void update_task_scan_period(struct task_struct *p,
 	 */
 	period_slot = DIV_ROUND_UP(p->numa_scan_period, NUMA_PERIOD_SLOTS);
 	ratio = (local * NUMA_PERIOD_SLOTS) / (local + remote);
+
+	/*
+	 * Track convergence: almost exclusively local windows back the
+	 * scan period off exponentially, and after a few of them in a
+	 * row the scanner is parked - see task_numa_work().
+	 */
+	if (ratio >= NUMA_SCAN_SETTLE_RATIO) {
+		if (!numa_scan_settled(p) &&
+		    ++p->numa_scan_settled >= NUMA_SCAN_SETTLE_COUNT)
+			p->numa_scan_settled_rss = get_mm_rss(p->mm);
+		p->numa_scan_period = min(p->numa_scan_period_max,
+					  p->numa_scan_period << 1);
+		memset(p->numa_faults_locality, 0,
+		       sizeof(p->numa_faults_locality));
+		return;
+	}
+	numa_scan_unsettle(p);
+
 	if (ratio >= NUMA_PERIOD_THRESHOLD) {
 		int slot = ratio - NUMA_PERIOD_THRESHOLD;
 		if (!slot)
@@ -2394,6 +2444,21 @@ void task_numa_work(struct callback_head *work)
 	if (p->flags & PF_EXITING)
 		return;
 
+	/*
+	 * Placement has converged; keep the scanner parked unless the
+	 * task is running away from its preferred node or the address
+	 * space has grown enough that new memory needs placing.
+	 */
+	if (numa_scan_settled(p)) {
+		if ((p->numa_preferred_nid != -1 &&
+		     task_node(p) != p->numa_preferred_nid) ||
+		    get_mm_rss(mm) > p->numa_scan_settled_rss +
+				     (p->numa_scan_settled_rss >> 3))
+			numa_scan_unsettle(p);
+		else
+			return;
+	}
+
 	if (!mm->numa_next_scan) {
 		mm->numa_next_scan = now +
 			msecs_to_jiffies(sysctl_numa_balancing_scan_delay);
@@ -4527,6 +4592,109 @@ static inline void hrtick_update(struct rq *rq)
 }
 #endif
 
+#ifdef CONFIG_SMP
+/*
+ * Estimated utilization tracking: on every dequeue, sample the task's
+ * current util_avg into an EWMA, and while a task is enqueued, account
+ * the max of its decayed average and that EWMA in the root cfs_rq.
+ * This preserves the task's recent peak demand across sleeps, so
+ * cpufreq can restore the matching frequency immediately on wakeup.
+ */
+static inline unsigned long _task_util_est(struct task_struct *p)
+{
+	struct util_est ue = READ_ONCE(p->se.avg.util_est);
+
+	return max(ue.ewma, ue.enqueued);
+}
+
+static inline void util_est_enqueue(struct cfs_rq *cfs_rq,
+				    struct task_struct *p)
+{
+	unsigned int enqueued;
+
+	if (!sched_feat(UTIL_EST))
+		return;
+
+	/* Update root cfs_rq's estimated utilization */
+	enqueued  = cfs_rq->avg.util_est.enqueued;
+	enqueued += _task_util_est(p);
+	WRITE_ONCE(cfs_rq->avg.util_est.enqueued, enqueued);
+}
+
+/*
+ * Check if a (signed) value is within a specified (unsigned) margin,
+ * based on the observation that:
+ *
+ *     abs(x) < y := (unsigned)(x + y - 1) < (2 * y - 1)
+ *
+ * NOTE: this only works when value + margin < INT_MAX.
+ */
+static inline bool within_margin(int value, int margin)
+{
+	return ((unsigned int)(value + margin - 1) < (2 * margin - 1));
+}
+
+static void util_est_dequeue(struct cfs_rq *cfs_rq,
+			     struct task_struct *p, bool task_sleep)
+{
+	long last_ewma_diff;
+	struct util_est ue;
+
+	if (!sched_feat(UTIL_EST))
+		return;
+
+	/* Update root cfs_rq's estimated utilization */
+	ue.enqueued  = cfs_rq->avg.util_est.enqueued;
+	ue.enqueued -= min_t(unsigned int, ue.enqueued, _task_util_est(p));
+	WRITE_ONCE(cfs_rq->avg.util_est.enqueued, ue.enqueued);
+
+	/*
+	 * Skip update of task's estimated utilization when the task has not
+	 * yet completed an activation, e.g. being migrated.
+	 */
+	if (!task_sleep)
+		return;
+
+	/*
+	 * Skip update of task's estimated utilization when its EWMA is
+	 * already ~1% close to its last activation value.
+	 */
+	ue = p->se.avg.util_est;
+	ue.enqueued = READ_ONCE(p->se.avg.util_avg);
+	last_ewma_diff = ue.enqueued - ue.ewma;
+	if (within_margin(last_ewma_diff, (SCHED_CAPACITY_SCALE / 100)))
+		return;
+
+	/*
+	 * Update Task's estimated utilization
+	 *
+	 * When *p completes an activation we can consolidate another sample
+	 * of the task size. This is done by storing the current PELT value
+	 * as ue.enqueued and by using this value to update the Exponential
+	 * Weighted Moving Average (EWMA):
+	 *
+	 *  ewma(t) =  w *  task_util(p) + (1-w) * ewma(t-1)
+	 *          =  w *  task_util(p) +         ewma(t-1)  - w * ewma(t-1)
+	 *          =  w * (task_util(p) -         ewma(t-1)) +     ewma(t-1)
+	 *          =  w * (      last_ewma_diff            ) +     ewma(t-1)
+	 *          =  w * (last_ewma_diff  +  ewma(t-1) / w)
+	 *
+	 * Where 'w' is the weight of new samples, which is configured to be
+	 * 0.25, thus making w=1/4 ( >>= UTIL_EST_WEIGHT_SHIFT)
+	 */
+	ue.ewma <<= UTIL_EST_WEIGHT_SHIFT;
+	ue.ewma  += last_ewma_diff;
+	ue.ewma >>= UTIL_EST_WEIGHT_SHIFT;
+	WRITE_ONCE(p->se.avg.util_est, ue);
+}
+#else /* !CONFIG_SMP */
+static inline void
+util_est_enqueue(struct cfs_rq *cfs_rq, struct task_struct *p) {}
+static inline void
+util_est_dequeue(struct cfs_rq *cfs_rq, struct task_struct *p,
+		 bool task_sleep) {}
+#endif /* CONFIG_SMP */
+
 /*
  * The enqueue_task method is called before nr_running is
  * increased. Here we update the fair scheduling stats and
@@ -4546,6 +4714,14 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	if (p->in_iowait)
 		cpufreq_update_this_cpu(rq, SCHED_CPUFREQ_IOWAIT);
 
+	/*
+	 * The code below (indirectly) updates schedutil which looks at
+	 * the cfs_rq utilization to select a frequency.
+	 * Let's add the task's estimated utilization to the cfs_rq's
+	 * estimated utilization, before we update schedutil.
+	 */
+	util_est_enqueue(&rq->cfs, p);
+
 	for_each_sched_entity(se) {
 		if (se->on_rq)
 			break;
@@ -4638,6 +4814,7 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	if (!se)
 		sub_nr_running(rq, 1);
 
+	util_est_dequeue(&rq->cfs, p, task_sleep);
 	hrtick_update(rq);
 }
 
@@ -5478,11 +5655,12 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
  */
 static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int target)
 {
+	struct sched_domain_shared *sds;
 	struct sched_domain *this_sd;
 	u64 avg_cost, avg_idle = this_rq()->avg_idle;
 	u64 time, cost;
 	s64 delta;
-	int cpu, wrap;
+	int cpu, start, nr = INT_MAX, wrap;
 
 	this_sd = rcu_dereference(*this_cpu_ptr(&sd_llc));
 	if (!this_sd)
@@ -5497,15 +5675,51 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, int t
 	if ((avg_idle / 512) < avg_cost)
 		return -1;
 
+	/*
+	 * Bound the number of CPUs inspected proportionally to the time we
+	 * can expect to spend idle; a mostly busy LLC only gets a token
+	 * scan while a mostly idle one may be walked entirely.
+	 */
+	if (sched_feat(SIS_PROP)) {
+		u64 span_avg = sd->span_weight * avg_idle;
+
+		if (span_avg > 4 * avg_cost)
+			nr = div_u64(span_avg, avg_cost);
+		else
+			nr = 4;
+	}
+
+	/*
+	 * Continue from where the previous (possibly truncated) scan left
+	 * off, so repeated bounded scans cover the whole LLC over time.
+	 */
+	start = target;
+	sds = rcu_dereference(per_cpu(sd_llc_shared, target));
+	if (sds) {
+		start = READ_ONCE(sds->idle_scan_cursor);
+		if ((unsigned)start >= nr_cpumask_bits ||
+		    !cpumask_test_cpu(start, sched_domain_span(sd)))
+			start = target;
+	}
+
 	time = local_clock();
 
-	for_each_cpu_wrap(cpu, sched_domain_span(sd), target, wrap) {
+	for_each_cpu_wrap(cpu, sched_domain_span(sd), start, wrap) {
+		if (!nr--)
+			break;
 		if (!cpumask_test_cpu(cpu, tsk_cpus_allowed(p)))
 			continue;
 		if (idle_cpu(cpu))
 			break;
 	}
 
+	if (sds)
+		WRITE_ONCE(sds->idle_scan_cursor,
+			   (unsigned)cpu < nr_cpumask_bits ? cpu : start);
+
+	if (nr < 0)
+		cpu = -1;
+
 	time = local_clock() - time;
 	cost = this_sd->avg_scan_cost;
 	delta = (s64)(time - cost) / 8;
@@ -5780,6 +5994,16 @@ wakeup_gran(struct sched_entity *curr, struct sched_entity *se)
 	 * This is especially important for buddies when the leftmost
 	 * task is higher priority than the buddy.
 	 */
+
+	/*
+	 * Scale the granularity by the waking task's latency hint: each
+	 * latency nice step is worth 1/40th of the granularity, so a -20
+	 * task preempts with half the usual granularity while a +19 task
+	 * has to build up nearly twice the vruntime deficit.
+	 */
+	if (entity_is_task(se))
+		gran += (long)gran * task_of(se)->latency_nice / 40;
+
 	return calc_delta_fair(gran, se);
 }
 
@@ -5864,6 +6088,18 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 		next_buddy_marked = 1;
 	}
 
+	/*
+	 * Bias the next pick towards a waking task that asked for lower
+	 * latency than the running one, even when it does not win the
+	 * preemption check below: pick_next_entity() will prefer the
+	 * next buddy whenever fairness permits.
+	 */
+	if (!next_buddy_marked && scale && !(wake_flags & WF_FORK) &&
+	    p->latency_nice < curr->latency_nice) {
+		set_next_buddy(pse);
+		next_buddy_marked = 1;
+	}
+
 	/*
 	 * We can come here with TIF_NEED_RESCHED already set from new task
 	 * wake up path.
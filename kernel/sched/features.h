@@ -64,8 +64,22 @@ SCHED_FEAT(TTWU_QUEUE, true)
 SCHED_FEAT(RT_PUSH_IPI, true)
 #endif
 
+/*
+ * When doing wakeups, attempt to limit the scan of the LLC domain for an
+ * idle CPU to a number of CPUs proportional to the estimated idleness of
+ * this CPU, so the scan cost stays bounded as the LLC grows.
+ */
+SCHED_FEAT(SIS_PROP, true)
+
 SCHED_FEAT(FORCE_SD_OVERLAP, false)
 SCHED_FEAT(RT_RUNTIME_SHARE, true)
 SCHED_FEAT(LB_MIN, false)
 SCHED_FEAT(ATTACH_AGE_LOAD, true)
 
+/*
+ * UtilEstimation. Use estimated CPU utilization to drive the frequency
+ * selection, so that a periodic task resumes at the frequency matching
+ * its recent peak demand instead of the decayed PELT average.
+ */
+SCHED_FEAT(UTIL_EST, true)
+
@@ -510,6 +510,16 @@ struct dl_rq {
 
 	unsigned long dl_nr_running;
 
+	/*
+	 * "Active utilization" for this runqueue: sum of the dl_bw of
+	 * the -deadline tasks queued here, increased when a task wakes
+	 * up and decreased when it blocks.  This is what the GRUB
+	 * reclaiming rule in update_curr_dl() scales runtime depletion
+	 * by, so tasks with SCHED_FLAG_RECLAIM can consume bandwidth
+	 * currently unused by other deadline reservations.
+	 */
+	u64 running_bw;
+
 #ifdef CONFIG_SMP
 	/*
 	 * Deadline values of the currently executing and the
@@ -1072,6 +1082,26 @@ extern struct static_key sched_feat_keys[__SCHED_FEAT_NR];
 extern struct static_key_false sched_numa_balancing;
 extern struct static_key_false sched_schedstats;
 
+#ifdef CONFIG_SMP
+/*
+ * CFS utilization of a runqueue as seen by cpufreq: the max of the
+ * decaying PELT average and the estimated utilization of the currently
+ * enqueued tasks, so a waking periodic task immediately restores the
+ * frequency matching its recent peak demand.
+ */
+static inline unsigned long cpu_util_cfs(struct rq *rq)
+{
+	unsigned long util = READ_ONCE(rq->cfs.avg.util_avg);
+
+	if (sched_feat(UTIL_EST)) {
+		util = max_t(unsigned long, util,
+			     READ_ONCE(rq->cfs.avg.util_est.enqueued));
+	}
+
+	return util;
+}
+#endif
+
 static inline u64 global_rt_period(void)
 {
 	return (u64)sysctl_sched_rt_period * NSEC_PER_USEC;
@@ -1163,6 +1193,7 @@ static inline void finish_lock_switch(struct rq *rq, struct task_struct *prev)
 #define WF_SYNC		0x01		/* waker goes to sleep after wakeup */
 #define WF_FORK		0x02		/* child wakeup after fork */
 #define WF_MIGRATED	0x4		/* internal use, task got migrated */
+#define WF_QUEUE	0x8		/* queue remote wakeup, coalescing IPIs */
 
 /*
  * To aid in avoiding the subversion of "niceness" due to uneven distribution
@@ -1353,6 +1384,9 @@ extern struct dl_bandwidth def_dl_bandwidth;
 extern void init_dl_bandwidth(struct dl_bandwidth *dl_b, u64 period, u64 runtime);
 extern void init_dl_task_timer(struct sched_dl_entity *dl_se);
 
+#define BW_SHIFT	20
+#define BW_UNIT		(1 << BW_SHIFT)
+
 unsigned long to_ratio(u64 period, u64 runtime);
 
 extern void init_entity_runnable_average(struct sched_entity *se);
@@ -2270,6 +2270,17 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 	case PR_GET_FP_MODE:
 		error = GET_FP_MODE(me);
 		break;
+	case PR_SET_CORE_COOKIE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = sched_core_set_cookie(me, arg2);
+		break;
+	case PR_GET_CORE_COOKIE:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = put_user(sched_core_get_cookie(me),
+				 (unsigned long __user *)arg2);
+		break;
 	default:
 		error = -EINVAL;
 		break;
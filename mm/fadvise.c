@@ -18,6 +18,8 @@
 #include <linux/writeback.h>
 #include <linux/syscalls.h>
 #include <linux/swap.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include <asm/unistd.h>
 
@@ -25,6 +27,59 @@
  * POSIX_FADV_WILLNEED could set PG_Referenced, and POSIX_FADV_NOREUSE could
  * deactivate the pages and clear PG_Referenced.
  */
+
+struct fadvise_async_work {
+	struct work_struct work;
+	struct file *file;
+	pgoff_t start_index;
+	unsigned long nrpages;
+};
+
+/*
+ * Cap the number of in-flight POSIX_FADV_WILLNEED_ASYNC requests; each
+ * one pins a struct file and a work item.  Requests beyond the cap are
+ * simply served synchronously, which is always a valid implementation
+ * of the hint.
+ */
+#define FADVISE_ASYNC_MAX_WORK	256
+static atomic_t fadvise_async_work_nr = ATOMIC_INIT(0);
+
+static void fadvise_async_readahead_workfn(struct work_struct *work)
+{
+	struct fadvise_async_work *raw =
+		container_of(work, struct fadvise_async_work, work);
+
+	force_page_cache_readahead(raw->file->f_mapping, raw->file,
+				   raw->start_index, raw->nrpages);
+	fput(raw->file);
+	kfree(raw);
+	atomic_dec(&fadvise_async_work_nr);
+}
+
+static bool fadvise_async_readahead(struct file *file, pgoff_t start_index,
+				    unsigned long nrpages)
+{
+	struct fadvise_async_work *raw;
+
+	if (atomic_inc_return(&fadvise_async_work_nr) >
+			FADVISE_ASYNC_MAX_WORK)
+		goto dec;
+
+	raw = kmalloc(sizeof(*raw), GFP_KERNEL);
+	if (!raw)
+		goto dec;
+
+	INIT_WORK(&raw->work, fadvise_async_readahead_workfn);
+	raw->file = get_file(file);
+	raw->start_index = start_index;
+	raw->nrpages = nrpages;
+	queue_work(system_unbound_wq, &raw->work);
+	return true;
+
+dec:
+	atomic_dec(&fadvise_async_work_nr);
+	return false;
+}
 SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 {
 	struct fd f = fdget(fd);
@@ -58,6 +113,7 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 		case POSIX_FADV_RANDOM:
 		case POSIX_FADV_SEQUENTIAL:
 		case POSIX_FADV_WILLNEED:
+		case POSIX_FADV_WILLNEED_ASYNC:
 		case POSIX_FADV_NOREUSE:
 		case POSIX_FADV_DONTNEED:
 			/* no bad return value, but ignore advice */
@@ -96,6 +152,7 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 		spin_unlock(&f.file->f_lock);
 		break;
 	case POSIX_FADV_WILLNEED:
+	case POSIX_FADV_WILLNEED_ASYNC:
 		/* First and last PARTIAL page! */
 		start_index = offset >> PAGE_SHIFT;
 		end_index = endbyte >> PAGE_SHIFT;
@@ -105,6 +162,10 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 		if (!nrpages)
 			nrpages = ~0UL;
 
+		if (advice == POSIX_FADV_WILLNEED_ASYNC &&
+		    fadvise_async_readahead(f.file, start_index, nrpages))
+			break;
+
 		/*
 		 * Ignore return value because fadvise() shall return
 		 * success even if filesystem can't retrieve a hint,
@@ -23,6 +23,7 @@
 #include <linux/swapops.h>
 #include <linux/page-isolation.h>
 #include <linux/jhash.h>
+#include <linux/llist.h>
 
 #include <asm/page.h>
 #include <asm/pgtable.h>
@@ -33,6 +34,7 @@
 #include <linux/hugetlb_cgroup.h>
 #include <linux/node.h>
 #include "internal.h"
+#include "hugetlb_vmemmap.h"
 
 int hugepages_treat_as_movable;
 
@@ -1165,15 +1167,10 @@ static inline int alloc_fresh_gigantic_page(struct hstate *h,
 					nodemask_t *nodes_allowed) { return 0; }
 #endif
 
-static void update_and_free_page(struct hstate *h, struct page *page)
+static void __update_and_free_page(struct hstate *h, struct page *page)
 {
 	int i;
 
-	if (hstate_is_gigantic(h) && !gigantic_page_supported())
-		return;
-
-	h->nr_huge_pages--;
-	h->nr_huge_pages_node[page_to_nid(page)]--;
 	for (i = 0; i < pages_per_huge_page(h); i++) {
 		page[i].flags &= ~(1 << PG_locked | 1 << PG_error |
 				1 << PG_referenced | 1 << PG_dirty |
@@ -1191,6 +1188,97 @@ static void update_and_free_page(struct hstate *h, struct page *page)
 	}
 }
 
+#ifdef CONFIG_HUGETLB_PAGE_FREE_VMEMMAP
+/*
+ * Put @page back on @h's free list as if it had never left, undoing the
+ * accounting done by update_and_free_page().  Used when the vmemmap of
+ * the page could not be restored; the page must remain a HugeTLB page
+ * because most of its struct pages are read-only aliases.
+ */
+static void add_hugetlb_page(struct hstate *h, struct page *page)
+{
+	int nid = page_to_nid(page);
+
+	INIT_LIST_HEAD(&page->lru);
+	spin_lock(&hugetlb_lock);
+	h->nr_huge_pages++;
+	h->nr_huge_pages_node[nid]++;
+	list_add(&page->lru, &h->hugepage_freelists[nid]);
+	h->free_huge_pages++;
+	h->free_huge_pages_node[nid]++;
+	spin_unlock(&hugetlb_lock);
+}
+
+/*
+ * Pages with freed vmemmap cannot be released under hugetlb_lock:
+ * restoring the vmemmap allocates pages and may sleep.  Queue them on a
+ * lockless list (reusing page->mapping, which free_huge_page() has
+ * already cleared, as the llist_node) and free them from a workqueue.
+ */
+static LLIST_HEAD(hpage_vmemmap_freelist);
+
+static void free_hpage_vmemmap_workfn(struct work_struct *work)
+{
+	struct llist_node *node;
+
+	node = llist_del_all(&hpage_vmemmap_freelist);
+	while (node) {
+		struct page *page;
+		struct hstate *h;
+
+		page = container_of((struct address_space **)node,
+				    struct page, mapping);
+		node = node->next;
+		page->mapping = NULL;
+		/*
+		 * The compound metadata lives in the kept vmemmap pages,
+		 * so page_hstate() is still valid here.
+		 */
+		h = page_hstate(page);
+
+		if (alloc_huge_page_vmemmap(h, page))
+			add_hugetlb_page(h, page);
+		else
+			__update_and_free_page(h, page);
+
+		cond_resched();
+	}
+}
+static DECLARE_WORK(free_hpage_vmemmap_work, free_hpage_vmemmap_workfn);
+
+static inline void defer_free_hpage_vmemmap(struct page *page)
+{
+	llist_add((struct llist_node *)&page->mapping, &hpage_vmemmap_freelist);
+	schedule_work(&free_hpage_vmemmap_work);
+}
+#else
+static inline void defer_free_hpage_vmemmap(struct page *page)
+{
+}
+#endif /* CONFIG_HUGETLB_PAGE_FREE_VMEMMAP */
+
+static void update_and_free_page(struct hstate *h, struct page *page)
+{
+	if (hstate_is_gigantic(h) && !gigantic_page_supported())
+		return;
+
+	h->nr_huge_pages--;
+	h->nr_huge_pages_node[page_to_nid(page)]--;
+
+	/*
+	 * If the vmemmap of the page was freed, the tail struct pages
+	 * are read-only aliases and the page cannot be dissolved until
+	 * the mapping has been restored, which may sleep.  Most callers
+	 * hold hugetlb_lock, so always take the deferred path.
+	 */
+	if (HPageVmemmapOptimized(page)) {
+		defer_free_hpage_vmemmap(page);
+		return;
+	}
+
+	__update_and_free_page(h, page);
+}
+
 struct hstate *size_to_hstate(unsigned long size)
 {
 	struct hstate *h;
@@ -1276,6 +1364,7 @@ void free_huge_page(struct page *page)
 
 static void prep_new_huge_page(struct hstate *h, struct page *page, int nid)
 {
+	free_huge_page_vmemmap(h, page);
 	INIT_LIST_HEAD(&page->lru);
 	set_compound_page_dtor(page, HUGETLB_PAGE_DTOR);
 	spin_lock(&hugetlb_lock);
@@ -0,0 +1,267 @@
+/*
+ * Free unused vmemmap pages of HugeTLB pages.
+ *
+ * A HugeTLB page is described by pages_per_huge_page() struct pages,
+ * but beyond the head and the first few tails those struct pages are
+ * never referenced individually, and every tail's struct page holds
+ * identical content (a pointer back to the head).  When enabled with
+ * hugetlb_free_vmemmap=on, the vmemmap pages describing the later
+ * tails are remapped read-only onto the page describing the first
+ * tails and freed: ~16MB recovered per 1GB page, 24KB per 2MB page.
+ * The mapping is restored before the huge page is returned to the
+ * buddy allocator.
+ */
+#define pr_fmt(fmt)	"HugeTLB: " fmt
+
+#include <linux/mm.h>
+#include <linux/hugetlb.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+#include <asm/pgalloc.h>
+#include <asm/tlbflush.h>
+#include "hugetlb_vmemmap.h"
+
+/*
+ * The first vmemmap page describes the head, the second describes
+ * tails whose struct pages look exactly like every later tail's; both
+ * are kept, and the second doubles as the target of the read-only
+ * aliases installed over the rest of the range.
+ */
+#define RESERVE_VMEMMAP_NR	2U
+#define RESERVE_VMEMMAP_SIZE	(RESERVE_VMEMMAP_NR << PAGE_SHIFT)
+
+bool hugetlb_free_vmemmap_enabled __read_mostly;
+
+static int __init early_hugetlb_free_vmemmap_param(char *buf)
+{
+	/* The alias trick needs vmemmap pages to hold whole struct pages */
+	if (!is_power_of_2(sizeof(struct page))) {
+		pr_warn("cannot free vmemmap pages because \"struct page\" crosses page boundaries\n");
+		return 0;
+	}
+
+	if (!buf)
+		return -EINVAL;
+
+	if (!strcmp(buf, "on"))
+		hugetlb_free_vmemmap_enabled = true;
+	else if (strcmp(buf, "off"))
+		return -EINVAL;
+
+	return 0;
+}
+early_param("hugetlb_free_vmemmap", early_hugetlb_free_vmemmap_param);
+
+static unsigned long vmemmap_pages_per_hpage(struct hstate *h)
+{
+	return (unsigned long)pages_per_huge_page(h) * sizeof(struct page) >>
+	       PAGE_SHIFT;
+}
+
+/*
+ * Split a huge pmd in the vmemmap mapping into a pte table mapping the
+ * same range, so that individual vmemmap pages can be remapped.
+ */
+static int vmemmap_split_pmd(pmd_t *pmd, unsigned long start)
+{
+	pte_t *pgtable;
+	unsigned long addr;
+	unsigned long pfn;
+	int i;
+
+	pgtable = pte_alloc_one_kernel(&init_mm, start);
+	if (!pgtable)
+		return -ENOMEM;
+
+	spin_lock(&init_mm.page_table_lock);
+	if (unlikely(!pmd_huge(*pmd))) {
+		/* somebody else split it under us */
+		spin_unlock(&init_mm.page_table_lock);
+		pte_free_kernel(&init_mm, pgtable);
+		return 0;
+	}
+
+	pfn = pmd_pfn(*pmd);
+	for (i = 0, addr = start; i < PTRS_PER_PTE; i++, addr += PAGE_SIZE)
+		set_pte_at(&init_mm, addr, pgtable + i,
+			   pfn_pte(pfn + i, PAGE_KERNEL));
+	/* Make the ptes visible before the pmd points at them */
+	smp_wmb();
+	pmd_populate_kernel(&init_mm, pmd, pgtable);
+	spin_unlock(&init_mm.page_table_lock);
+
+	flush_tlb_kernel_range(start, start + PMD_SIZE);
+	return 0;
+}
+
+/*
+ * Walk to the pte mapping @addr in the vmemmap, splitting a huge pmd
+ * on demand.  Returns NULL if a page table cannot be allocated.
+ */
+static pte_t *vmemmap_pte(unsigned long addr)
+{
+	pgd_t *pgd = pgd_offset_k(addr);
+	pud_t *pud = pud_offset(pgd, addr);
+	pmd_t *pmd = pmd_offset(pud, addr);
+
+	if (unlikely(pmd_huge(*pmd))) {
+		if (vmemmap_split_pmd(pmd, addr & PMD_MASK))
+			return NULL;
+	}
+
+	return pte_offset_kernel(pmd, addr);
+}
+
+/*
+ * Remap the vmemmap range [@start, @end) read-only onto the page
+ * mapped at @reuse (the page below @start) and free the pages that
+ * backed it.  On allocation failure every pte touched so far is
+ * restored and -ENOMEM is returned.
+ */
+static int vmemmap_remap_free(unsigned long start, unsigned long end,
+			      unsigned long reuse)
+{
+	LIST_HEAD(vmemmap_pages);
+	struct page *page, *next;
+	unsigned long reuse_pfn;
+	unsigned long addr;
+	pte_t *pte;
+
+	VM_BUG_ON(reuse != start - PAGE_SIZE);
+
+	pte = vmemmap_pte(reuse);
+	if (!pte)
+		return -ENOMEM;
+	reuse_pfn = pte_pfn(*pte);
+
+	for (addr = start; addr < end; addr += PAGE_SIZE) {
+		pte = vmemmap_pte(addr);
+		if (!pte)
+			goto restore;
+
+		list_add(&pte_page(*pte)->lru, &vmemmap_pages);
+		set_pte_at(&init_mm, addr, pte,
+			   pfn_pte(reuse_pfn, PAGE_KERNEL_RO));
+	}
+
+	flush_tlb_kernel_range(start, end);
+
+	list_for_each_entry_safe(page, next, &vmemmap_pages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	return 0;
+
+restore:
+	/* the most recently remapped page sits at the head of the list */
+	while (addr > start) {
+		addr -= PAGE_SIZE;
+		page = list_first_entry(&vmemmap_pages, struct page, lru);
+		list_del(&page->lru);
+		pte = vmemmap_pte(addr);
+		set_pte_at(&init_mm, addr, pte,
+			   pfn_pte(page_to_pfn(page), PAGE_KERNEL));
+	}
+	flush_tlb_kernel_range(start, end);
+	return -ENOMEM;
+}
+
+/*
+ * Undo vmemmap_remap_free(): back every page of [@start, @end) with a
+ * freshly allocated page holding a copy of the tail template at
+ * @reuse.  Fails without side effects if the pages cannot be
+ * allocated.
+ */
+static int vmemmap_remap_alloc(unsigned long start, unsigned long end,
+			       unsigned long reuse)
+{
+	LIST_HEAD(vmemmap_pages);
+	struct page *page, *next;
+	unsigned long addr;
+	int nid = page_to_nid(virt_to_page(reuse));
+	long i, nr_pages = (end - start) >> PAGE_SHIFT;
+	pte_t *pte;
+
+	for (i = 0; i < nr_pages; i++) {
+		page = alloc_pages_node(nid, GFP_KERNEL, 0);
+		if (!page)
+			goto out_free;
+		list_add(&page->lru, &vmemmap_pages);
+	}
+
+	for (addr = start; addr < end; addr += PAGE_SIZE) {
+		page = list_first_entry(&vmemmap_pages, struct page, lru);
+		list_del(&page->lru);
+
+		copy_page(page_address(page), (void *)reuse);
+		/* the pmd was split when the range was freed */
+		pte = vmemmap_pte(addr);
+		set_pte_at(&init_mm, addr, pte,
+			   pfn_pte(page_to_pfn(page), PAGE_KERNEL));
+	}
+
+	flush_tlb_kernel_range(start, end);
+	return 0;
+
+out_free:
+	list_for_each_entry_safe(page, next, &vmemmap_pages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+	return -ENOMEM;
+}
+
+/*
+ * Restore the vmemmap of @head before it is handed back to the buddy
+ * allocator.  Returns -ENOMEM if the backing pages cannot be
+ * allocated, in which case the page must stay a HugeTLB page.
+ */
+int alloc_huge_page_vmemmap(struct hstate *h, struct page *head)
+{
+	unsigned long vmemmap_addr = (unsigned long)head;
+	unsigned long vmemmap_end, vmemmap_reuse;
+	int ret;
+
+	if (!HPageVmemmapOptimized(head))
+		return 0;
+
+	vmemmap_end = vmemmap_addr +
+		      (vmemmap_pages_per_hpage(h) << PAGE_SHIFT);
+	vmemmap_addr += RESERVE_VMEMMAP_SIZE;
+	vmemmap_reuse = vmemmap_addr - PAGE_SIZE;
+
+	ret = vmemmap_remap_alloc(vmemmap_addr, vmemmap_end, vmemmap_reuse);
+	if (!ret)
+		head[1].private = 0;
+
+	return ret;
+}
+
+/*
+ * Free the vmemmap describing the later tails of @head.  Failure just
+ * means the page keeps its full vmemmap.
+ */
+void free_huge_page_vmemmap(struct hstate *h, struct page *head)
+{
+	unsigned long vmemmap_addr = (unsigned long)head;
+	unsigned long vmemmap_end, vmemmap_reuse;
+
+	head[1].private = 0;
+
+	if (!hugetlb_free_vmemmap_enabled)
+		return;
+	if (!is_power_of_2(sizeof(struct page)))
+		return;
+	if (vmemmap_pages_per_hpage(h) <= RESERVE_VMEMMAP_NR)
+		return;
+
+	vmemmap_end = vmemmap_addr +
+		      (vmemmap_pages_per_hpage(h) << PAGE_SHIFT);
+	vmemmap_addr += RESERVE_VMEMMAP_SIZE;
+	vmemmap_reuse = vmemmap_addr - PAGE_SIZE;
+
+	if (vmemmap_remap_free(vmemmap_addr, vmemmap_end, vmemmap_reuse))
+		return;
+
+	head[1].private = 1;
+}
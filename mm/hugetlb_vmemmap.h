@@ -0,0 +1,37 @@
+/*
+ * Free unused vmemmap pages of HugeTLB pages.
+ */
+#ifndef _MM_HUGETLB_VMEMMAP_H
+#define _MM_HUGETLB_VMEMMAP_H
+#include <linux/hugetlb.h>
+
+#ifdef CONFIG_HUGETLB_PAGE_FREE_VMEMMAP
+int alloc_huge_page_vmemmap(struct hstate *h, struct page *head);
+void free_huge_page_vmemmap(struct hstate *h, struct page *head);
+
+extern bool hugetlb_free_vmemmap_enabled;
+
+/*
+ * The flag lives in the first tail's private field, which sits in the
+ * vmemmap page that is always kept mapped read-write.
+ */
+static inline bool HPageVmemmapOptimized(struct page *head)
+{
+	return head[1].private != 0;
+}
+#else
+static inline int alloc_huge_page_vmemmap(struct hstate *h, struct page *head)
+{
+	return 0;
+}
+
+static inline void free_huge_page_vmemmap(struct hstate *h, struct page *head)
+{
+}
+
+static inline bool HPageVmemmapOptimized(struct page *head)
+{
+	return false;
+}
+#endif /* CONFIG_HUGETLB_PAGE_FREE_VMEMMAP */
+#endif /* _MM_HUGETLB_VMEMMAP_H */
@@ -826,6 +826,13 @@ static bool hugepage_vma_check(struct vm_area_struct *vma)
 		return IS_ALIGNED((vma->vm_start >> PAGE_SHIFT) - vma->vm_pgoff,
 				HPAGE_PMD_NR);
 	}
+	/* Read-only regular file mappings can be collapsed as well */
+	if (IS_ENABLED(CONFIG_READ_ONLY_THP_FOR_FS) && vma->vm_file &&
+	    !(vma->vm_flags & (VM_MAYWRITE | VM_SPECIAL)) &&
+	    !vma->anon_vma) {
+		return IS_ALIGNED((vma->vm_start >> PAGE_SHIFT) - vma->vm_pgoff,
+				HPAGE_PMD_NR);
+	}
 	if (!vma->anon_vma || vma->vm_ops)
 		return false;
 	if (is_vma_temporary_stack(vma))
@@ -1213,6 +1220,94 @@ out:
 	return ret;
 }
 
+/*
+ * madvise_collapse - synchronously collapse [start, end) into THPs
+ *
+ * Walk the pmd-aligned subrange of [start, end) and feed each pmd to
+ * the khugepaged collapse machinery, so that callers can pay the
+ * collapse cost up front instead of waiting for khugepaged to find
+ * the range.  Called with mmap_sem held for read; like madvise_remove
+ * the lock may be dropped and reacquired, which is signalled to
+ * sys_madvise by clearing *prev.
+ *
+ * Returns 0 if every eligible pmd in the range ends up backed by a
+ * huge page, -EAGAIN otherwise.
+ */
+int madvise_collapse(struct vm_area_struct *vma, struct vm_area_struct **prev,
+		     unsigned long start, unsigned long end)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *hpage = NULL;
+	unsigned long addr;
+	int nr_failed = 0;
+	bool locked = true;
+
+	*prev = NULL;	/* tell sys_madvise we may drop mmap_sem */
+
+	if (!hugepage_vma_check(vma) || shmem_file(vma->vm_file))
+		return -EINVAL;
+
+	for (addr = ALIGN(start, HPAGE_PMD_SIZE);
+	     addr + HPAGE_PMD_SIZE <= end; addr += HPAGE_PMD_SIZE) {
+		cond_resched();
+
+		if (!locked) {
+			down_read(&mm->mmap_sem);
+			locked = true;
+			if (hugepage_vma_revalidate(mm, addr, &vma)) {
+				nr_failed++;
+				break;
+			}
+		}
+
+		/*
+		 * khugepaged runs with a preallocated page on !NUMA,
+		 * and khugepaged_alloc_page() expects one here too.
+		 */
+		if (!IS_ENABLED(CONFIG_NUMA) && !hpage) {
+			hpage = alloc_pages(alloc_hugepage_khugepaged_gfpmask(),
+					    HPAGE_PMD_ORDER);
+			if (!hpage) {
+				count_vm_event(THP_COLLAPSE_ALLOC_FAILED);
+				nr_failed++;
+				break;
+			}
+			prep_transhuge_page(hpage);
+			count_vm_event(THP_COLLAPSE_ALLOC);
+		}
+
+		/* already backed by a huge pmd, or nothing mapped at all */
+		if (!mm_find_pmd(mm, addr))
+			continue;
+
+		if (!khugepaged_scan_pmd(mm, vma, addr, &hpage)) {
+			nr_failed++;
+			continue;
+		}
+
+		/* collapse_huge_page released mmap_sem */
+		locked = false;
+
+		if (IS_ERR(hpage)) {		/* allocation failed */
+			hpage = NULL;
+			nr_failed++;
+		} else if (hpage) {		/* page was not consumed */
+			if (IS_ENABLED(CONFIG_NUMA)) {
+				put_page(hpage);
+				hpage = NULL;
+			}
+			nr_failed++;
+		}
+	}
+
+	if (!locked)
+		down_read(&mm->mmap_sem);
+	if (!IS_ERR_OR_NULL(hpage))
+		put_page(hpage);
+
+	return nr_failed ? -EAGAIN : 0;
+}
+
 static void collect_mm_slot(struct mm_slot *mm_slot)
 {
 	struct mm_struct *mm = mm_slot->mm;
@@ -1276,13 +1371,18 @@ static void retract_page_tables(struct address_space *mapping, pgoff_t pgoff)
 }
 
 /**
- * collapse_shmem - collapse small tmpfs/shmem pages into huge one.
+ * collapse_file - collapse small file pages into huge one.
+ *
+ * The file must either be shmem or a regular file whose pages are
+ * read-only and uptodate: in the latter case writers are kept away with
+ * deny_write_access() while we work, and the first later open for write
+ * drops the huge page again (see do_dentry_open()).
  *
  * Basic scheme is simple, details are more complex:
  *  - allocate and freeze a new huge page;
  *  - scan over radix tree replacing old pages the new one
- *    + swap in pages if necessary;
- *    + fill in gaps;
+ *    + swap in pages if necessary (shmem only);
+ *    + fill in gaps (shmem only);
  *    + keep old pages around in case if rollback is required;
  *  - if replacing succeed:
  *    + copy data over;
@@ -1293,10 +1393,11 @@ static void retract_page_tables(struct address_space *mapping, pgoff_t pgoff)
  *    + restore gaps in the radix-tree;
  *    + free huge page;
  */
-static void collapse_shmem(struct mm_struct *mm,
-		struct address_space *mapping, pgoff_t start,
+static void collapse_file(struct mm_struct *mm,
+		struct file *file, pgoff_t start,
 		struct page **hpage, int node)
 {
+	struct address_space *mapping = file->f_mapping;
 	gfp_t gfp;
 	struct page *page, *new_page, *tmp;
 	struct mem_cgroup *memcg;
@@ -1305,9 +1406,21 @@ static void collapse_shmem(struct mm_struct *mm,
 	struct radix_tree_iter iter;
 	void **slot;
 	int nr_none = 0, result = SCAN_SUCCEED;
+	bool is_shmem = shmem_file(file);
 
+	VM_BUG_ON(!IS_ENABLED(CONFIG_READ_ONLY_THP_FOR_FS) && !is_shmem);
 	VM_BUG_ON(start & (HPAGE_PMD_NR - 1));
 
+	/*
+	 * A huge page in a regular file's page cache must stay read-only,
+	 * so block writers ETXTBSY-style for the duration of the collapse.
+	 * If the file is already open for write there is nothing to do.
+	 */
+	if (!is_shmem && deny_write_access(file)) {
+		result = SCAN_FAIL;
+		goto out;
+	}
+
 	/* Only allocate from the target node */
 	gfp = alloc_hugepage_khugepaged_gfpmask() |
 		__GFP_OTHER_NODE | __GFP_THISNODE;
@@ -1315,17 +1428,18 @@ static void collapse_shmem(struct mm_struct *mm,
 	new_page = khugepaged_alloc_page(hpage, gfp, node);
 	if (!new_page) {
 		result = SCAN_ALLOC_HUGE_PAGE_FAIL;
-		goto out;
+		goto out_allow;
 	}
 
 	if (unlikely(mem_cgroup_try_charge(new_page, mm, gfp, &memcg, true))) {
 		result = SCAN_CGROUP_CHARGE_FAIL;
-		goto out;
+		goto out_allow;
 	}
 
 	new_page->index = start;
 	new_page->mapping = mapping;
-	__SetPageSwapBacked(new_page);
+	if (is_shmem)
+		__SetPageSwapBacked(new_page);
 	__SetPageLocked(new_page);
 	BUG_ON(!page_ref_freeze(new_page, 1));
 
@@ -1345,10 +1459,14 @@ static void collapse_shmem(struct mm_struct *mm,
 		/*
 		 * Handle holes in the radix tree: charge it from shmem and
 		 * insert relevant subpage of new_page into the radix-tree.
+		 * A regular file has no way to fill holes from here, so any
+		 * hole disqualifies the range.
 		 */
-		if (n && !shmem_charge(mapping->host, n)) {
-			result = SCAN_FAIL;
-			break;
+		if (n) {
+			if (!is_shmem || !shmem_charge(mapping->host, n)) {
+				result = SCAN_FAIL;
+				break;
+			}
 		}
 		nr_none += n;
 		for (; index < min(iter.index, end); index++) {
@@ -1363,6 +1481,11 @@ static void collapse_shmem(struct mm_struct *mm,
 		page = radix_tree_deref_slot_protected(slot,
 				&mapping->tree_lock);
 		if (radix_tree_exceptional_entry(page) || !PageUptodate(page)) {
+			if (!is_shmem) {
+				/* Shadow entry: the page is not resident */
+				result = SCAN_FAIL;
+				break;
+			}
 			spin_unlock_irq(&mapping->tree_lock);
 			/* swap in or instantiate fallocated page */
 			if (shmem_getpage(mapping->host, index, &page,
@@ -1390,6 +1513,16 @@ static void collapse_shmem(struct mm_struct *mm,
 			result = SCAN_TRUNCATED;
 			goto out_unlock;
 		}
+
+		/*
+		 * khugepaged only deals with read-only regular file pages:
+		 * anything dirty or under IO disqualifies the range, or the
+		 * copy below would lose the unwritten data.
+		 */
+		if (!is_shmem && (PageDirty(page) || PageWriteback(page))) {
+			result = SCAN_FAIL;
+			goto out_unlock;
+		}
 		spin_unlock_irq(&mapping->tree_lock);
 
 		if (isolate_lru_page(page)) {
@@ -1401,6 +1534,14 @@ static void collapse_shmem(struct mm_struct *mm,
 			unmap_mapping_range(mapping, index << PAGE_SHIFT,
 					PAGE_SIZE, 0);
 
+		/* Buffer heads (or other fs private data) must go first */
+		if (!is_shmem && page_has_private(page) &&
+		    !try_to_release_page(page, GFP_KERNEL)) {
+			result = SCAN_FAIL;
+			putback_lru_page(page);
+			goto out_isolate_failed;
+		}
+
 		spin_lock_irq(&mapping->tree_lock);
 
 		VM_BUG_ON_PAGE(page_mapped(page), page);
@@ -1449,7 +1590,7 @@ out_unlock:
 	if (result == SCAN_SUCCEED && index < end) {
 		int n = end - index;
 
-		if (!shmem_charge(mapping->host, n)) {
+		if (!is_shmem || !shmem_charge(mapping->host, n)) {
 			result = SCAN_FAIL;
 			goto tree_locked;
 		}
@@ -1486,13 +1627,19 @@ tree_unlocked:
 		}
 
 		local_irq_save(flags);
-		__inc_node_page_state(new_page, NR_SHMEM_THPS);
+		if (is_shmem)
+			__inc_node_page_state(new_page, NR_SHMEM_THPS);
+		else
+			__inc_node_page_state(new_page, NR_FILE_THPS);
 		if (nr_none) {
 			__mod_node_page_state(zone->zone_pgdat, NR_FILE_PAGES, nr_none);
 			__mod_node_page_state(zone->zone_pgdat, NR_SHMEM, nr_none);
 		}
 		local_irq_restore(flags);
 
+		if (!is_shmem)
+			filemap_nr_thps_inc(mapping);
+
 		/*
 		 * Remove pte page tables, so we can re-faulti
 		 * the page as huge.
@@ -1500,17 +1647,22 @@ tree_unlocked:
 		retract_page_tables(mapping, start);
 
 		/* Everything is ready, let's unfreeze the new_page */
-		set_page_dirty(new_page);
+		if (is_shmem)
+			set_page_dirty(new_page);
 		SetPageUptodate(new_page);
 		page_ref_unfreeze(new_page, HPAGE_PMD_NR);
 		mem_cgroup_commit_charge(new_page, memcg, false, true);
-		lru_cache_add_anon(new_page);
+		if (is_shmem)
+			lru_cache_add_anon(new_page);
+		else
+			lru_cache_add_file(new_page);
 		unlock_page(new_page);
 
 		*hpage = NULL;
 	} else {
 		/* Something went wrong: rollback changes to the radix-tree */
-		shmem_uncharge(mapping->host, nr_none);
+		if (is_shmem)
+			shmem_uncharge(mapping->host, nr_none);
 		spin_lock_irq(&mapping->tree_lock);
 		radix_tree_for_each_slot(slot, &mapping->page_tree, &iter,
 				start) {
@@ -1547,18 +1699,29 @@ tree_unlocked:
 		unlock_page(new_page);
 		new_page->mapping = NULL;
 	}
+out_allow:
+	if (!is_shmem) {
+		/*
+		 * Make nr_thps visible before letting writers back in: a
+		 * writer that wins get_write_access() after this point must
+		 * see it and shoot the huge page down in do_dentry_open().
+		 */
+		smp_mb__before_atomic();
+		allow_write_access(file);
+	}
 out:
 	VM_BUG_ON(!list_empty(&pagelist));
 	/* TODO: tracepoints */
 }
 
-static void khugepaged_scan_shmem(struct mm_struct *mm,
-		struct address_space *mapping,
-		pgoff_t start, struct page **hpage)
+static void khugepaged_scan_file(struct mm_struct *mm,
+		struct file *file, pgoff_t start, struct page **hpage)
 {
 	struct page *page = NULL;
+	struct address_space *mapping = file->f_mapping;
 	struct radix_tree_iter iter;
 	void **slot;
+	bool is_shmem = shmem_file(file);
 	int present, swap;
 	int node = NUMA_NO_NODE;
 	int result = SCAN_SUCCEED;
@@ -1578,6 +1741,14 @@ static void khugepaged_scan_shmem(struct mm_struct *mm,
 		}
 
 		if (radix_tree_exception(page)) {
+			/*
+			 * Regular files cannot swap pages back in from here,
+			 * so a shadow (or DAX) entry kills the collapse.
+			 */
+			if (!is_shmem) {
+				result = SCAN_FAIL;
+				break;
+			}
 			if (++swap > khugepaged_max_ptes_swap) {
 				result = SCAN_EXCEED_SWAP_PTE;
 				break;
@@ -1602,7 +1773,13 @@ static void khugepaged_scan_shmem(struct mm_struct *mm,
 			break;
 		}
 
-		if (page_count(page) != 1 + page_mapcount(page)) {
+		/*
+		 * File pages may have fs private data (e.g. buffer heads)
+		 * attached: that pins one extra reference. collapse_file()
+		 * drops it with try_to_release_page().
+		 */
+		if (page_count(page) !=
+		    1 + page_mapcount(page) + page_has_private(page)) {
 			result = SCAN_PAGE_COUNT;
 			break;
 		}
@@ -1623,20 +1800,20 @@ static void khugepaged_scan_shmem(struct mm_struct *mm,
 	rcu_read_unlock();
 
 	if (result == SCAN_SUCCEED) {
-		if (present < HPAGE_PMD_NR - khugepaged_max_ptes_none) {
+		if (present < HPAGE_PMD_NR - khugepaged_max_ptes_none ||
+		    (!is_shmem && present < HPAGE_PMD_NR)) {
 			result = SCAN_EXCEED_NONE_PTE;
 		} else {
 			node = khugepaged_find_target_node();
-			collapse_shmem(mm, mapping, start, hpage, node);
+			collapse_file(mm, file, start, hpage, node);
 		}
 	}
 
 	/* TODO: tracepoints */
 }
 #else
-static void khugepaged_scan_shmem(struct mm_struct *mm,
-		struct address_space *mapping,
-		pgoff_t start, struct page **hpage)
+static void khugepaged_scan_file(struct mm_struct *mm,
+		struct file *file, pgoff_t start, struct page **hpage)
 {
 	BUILD_BUG();
 }
@@ -1705,17 +1882,20 @@ skip:
 			VM_BUG_ON(khugepaged_scan.address < hstart ||
 				  khugepaged_scan.address + HPAGE_PMD_SIZE >
 				  hend);
-			if (shmem_file(vma->vm_file)) {
+			if (IS_ENABLED(CONFIG_SHMEM) &&
+			    IS_ENABLED(CONFIG_TRANSPARENT_HUGE_PAGECACHE) &&
+			    vma->vm_file) {
 				struct file *file;
 				pgoff_t pgoff = linear_page_index(vma,
 						khugepaged_scan.address);
-				if (!shmem_huge_enabled(vma))
+
+				if (shmem_file(vma->vm_file) &&
+				    !shmem_huge_enabled(vma))
 					goto skip;
 				file = get_file(vma->vm_file);
 				up_read(&mm->mmap_sem);
 				ret = 1;
-				khugepaged_scan_shmem(mm, file->f_mapping,
-						pgoff, hpage);
+				khugepaged_scan_file(mm, file, pgoff, hpage);
 				fput(file);
 			} else {
 				ret = khugepaged_scan_pmd(mm, vma,
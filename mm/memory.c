@@ -2544,10 +2544,9 @@ int do_swap_page(struct fault_env *fe, pte_t orig_pte)
 		goto out;
 	}
 	delayacct_set_flag(DELAYACCT_PF_SWAPIN);
-	page = lookup_swap_cache(entry);
+	page = lookup_swap_cache(entry, vma, fe->address);
 	if (!page) {
-		page = swapin_readahead(entry,
-					GFP_HIGHUSER_MOVABLE, vma, fe->address);
+		page = swapin_readahead(entry, GFP_HIGHUSER_MOVABLE, fe);
 		if (!page) {
 			/*
 			 * Back out if somebody else faulted in this pte
@@ -3090,6 +3089,24 @@ static int __init fault_around_debugfs(void)
 late_initcall(fault_around_debugfs);
 #endif
 
+/*
+ * How many pages do_fault_around() may map for a fault in @vma.  The
+ * global fault_around_bytes default is overridden by the per-vma
+ * madvise() read hints: an MADV_RANDOM vma gets no fault-around at all
+ * (the surrounding pages are unlikely to be referenced and mapping
+ * them only adds rmap and reclaim work), while an MADV_SEQUENTIAL one
+ * gets the largest window we can serve under a single page table lock.
+ */
+static unsigned long fault_around_pages(struct vm_area_struct *vma)
+{
+	if (vma->vm_flags & VM_RAND_READ)
+		return 1;
+	if (vma->vm_flags & VM_SEQ_READ)
+		return PTRS_PER_PTE;
+
+	return READ_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+}
+
 /*
  * do_fault_around() tries to map few pages around the fault address. The hope
  * is that the pages will be needed soon and this will lower the number of
@@ -3119,7 +3136,7 @@ static int do_fault_around(struct fault_env *fe, pgoff_t start_pgoff)
 	pgoff_t end_pgoff;
 	int off, ret = 0;
 
-	nr_pages = READ_ONCE(fault_around_bytes) >> PAGE_SHIFT;
+	nr_pages = fault_around_pages(fe->vma);
 	mask = ~(nr_pages * PAGE_SIZE - 1) & PAGE_MASK;
 
 	fe->address = max(address & mask, fe->vma->vm_start);
@@ -3182,7 +3199,7 @@ static int do_read_fault(struct fault_env *fe, pgoff_t pgoff)
 	 * if page by the offset is not ready to be mapped (cold cache or
 	 * something).
 	 */
-	if (vma->vm_ops->map_pages && fault_around_bytes >> PAGE_SHIFT > 1) {
+	if (vma->vm_ops->map_pages && fault_around_pages(vma) > 1) {
 		ret = do_fault_around(fe, pgoff);
 		if (ret)
 			return ret;
@@ -3679,6 +3696,191 @@ int handle_mm_fault(struct vm_area_struct *vma, unsigned long address,
 }
 EXPORT_SYMBOL_GPL(handle_mm_fault);
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+/*
+ * rbtree depth is bounded by 2*log2(n+1); 64 covers any realistic VMA
+ * count and turns a walk corrupted by a concurrent rotation into a
+ * fallback instead of a livelock.
+ */
+#define SPF_RB_MAX_DEPTH	64
+
+/*
+ * Lockless find_vma().  The nodes are embedded in vm_area_structs
+ * which are type-stable (SLAB_DESTROY_BY_RCU), so every dereference
+ * hits a (possibly stale or recycled) VMA, never foreign memory.  The
+ * caller revalidates mm->mm_seq before trusting the result.
+ */
+static struct vm_area_struct *find_vma_rcu(struct mm_struct *mm,
+					   unsigned long address)
+{
+	struct rb_node *node = READ_ONCE(mm->mm_rb.rb_node);
+	struct vm_area_struct *vma = NULL;
+	int depth = 0;
+
+	while (node) {
+		struct vm_area_struct *tmp;
+
+		if (++depth > SPF_RB_MAX_DEPTH)
+			return NULL;
+
+		tmp = rb_entry(node, struct vm_area_struct, vm_rb);
+		if (READ_ONCE(tmp->vm_end) > address) {
+			vma = tmp;
+			if (READ_ONCE(tmp->vm_start) <= address)
+				break;
+			node = READ_ONCE(node->rb_left);
+		} else {
+			node = READ_ONCE(node->rb_right);
+		}
+	}
+
+	return vma;
+}
+
+/*
+ * Try to handle a user fault without mmap_sem.  Only the common case
+ * is taken on: a pte_none fault in a private anonymous VMA whose
+ * anon_vma is already set up.  Everything else - file and huge pages,
+ * stack growth, userfaultfd, COW - returns VM_FAULT_RETRY and is
+ * retried under mmap_sem by the caller.
+ *
+ * The VMA is found under RCU and every use of it is validated against
+ * mm->mm_seq, which writers bump around all tree and protection
+ * changes.  The page table walk runs with interrupts disabled: like
+ * fast GUP, this holds off the TLB-shootdown IPI that must complete
+ * before a page table page can be freed, so the walked tables cannot
+ * disappear under us.
+ */
+int handle_speculative_fault(struct mm_struct *mm, unsigned long address,
+			     unsigned int flags)
+{
+	struct vm_area_struct *vma;
+	struct mem_cgroup *memcg = NULL;
+	struct page *page = NULL;
+	unsigned long vm_flags;
+	spinlock_t *ptl;
+	unsigned int seq;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd, pmdval;
+	pte_t *pte, entry;
+	int ret = VM_FAULT_RETRY;
+
+	if (flags & FAULT_FLAG_REMOTE)
+		return VM_FAULT_RETRY;
+
+	seq = raw_read_seqcount(&mm->mm_seq);
+	if (seq & 1)
+		return VM_FAULT_RETRY;
+
+	rcu_read_lock();
+	vma = find_vma_rcu(mm, address);
+	if (!vma || READ_ONCE(vma->vm_mm) != mm ||
+	    address < READ_ONCE(vma->vm_start) ||
+	    address >= READ_ONCE(vma->vm_end))
+		goto out_rcu;
+
+	vm_flags = READ_ONCE(vma->vm_flags);
+	if (vma->vm_ops || !vma->anon_vma ||
+	    (vm_flags & (VM_SHARED | VM_SPECIAL | VM_HUGETLB |
+			 VM_GROWSDOWN | VM_GROWSUP |
+			 VM_UFFD_MISSING | VM_UFFD_WP)))
+		goto out_rcu;
+
+	if (flags & FAULT_FLAG_WRITE) {
+		if (!(vm_flags & VM_WRITE))
+			goto out_rcu;
+	} else if (!(vm_flags & (VM_READ | VM_EXEC))) {
+		goto out_rcu;
+	}
+
+	/* The snapshot above is only coherent if nothing changed. */
+	if (read_seqcount_retry(&mm->mm_seq, seq))
+		goto out_rcu;
+
+	count_vm_event(PGFAULT);
+	mem_cgroup_count_vm_event(mm, PGFAULT);
+
+	if (flags & FAULT_FLAG_WRITE) {
+		/* Allocate and charge before going non-preemptible. */
+		page = alloc_page(GFP_HIGHUSER_MOVABLE | __GFP_ZERO);
+		if (!page)
+			goto out_rcu;
+		if (mem_cgroup_try_charge(page, mm, GFP_KERNEL, &memcg,
+					  false)) {
+			put_page(page);
+			page = NULL;
+			goto out_rcu;
+		}
+		__SetPageUptodate(page);
+		entry = mk_pte(page, READ_ONCE(vma->vm_page_prot));
+		entry = pte_mkwrite(pte_mkdirty(entry));
+	} else {
+		if (mm_forbids_zeropage(mm))
+			goto out_rcu;
+		entry = pte_mkspecial(pfn_pte(my_zero_pfn(address),
+					      READ_ONCE(vma->vm_page_prot)));
+	}
+
+	local_irq_disable();
+	if (read_seqcount_retry(&mm->mm_seq, seq))
+		goto out_irq;
+
+	pgd = pgd_offset(mm, address);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		goto out_irq;
+	pud = pud_offset(pgd, address);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		goto out_irq;
+	pmd = pmd_offset(pud, address);
+	pmdval = READ_ONCE(*pmd);
+	if (!pmd_present(pmdval) || pmd_trans_huge(pmdval) ||
+	    pmd_devmap(pmdval) || unlikely(pmd_bad(pmdval)))
+		goto out_irq;
+
+	pte = pte_offset_map(pmd, address);
+	ptl = pte_lockptr(mm, pmd);
+	if (!spin_trylock(ptl))
+		goto out_unmap;
+	/*
+	 * Holding the pte lock with an unchanged mm_seq means no
+	 * munmap/mprotect has touched this range since the VMA was
+	 * snapshotted, and none can complete before we unlock.
+	 */
+	if (read_seqcount_retry(&mm->mm_seq, seq))
+		goto out_ptl;
+	if (!pte_none(*pte))
+		goto out_ptl;
+
+	if (page) {
+		inc_mm_counter_fast(mm, MM_ANONPAGES);
+		page_add_new_anon_rmap(page, vma, address, false);
+		mem_cgroup_commit_charge(page, memcg, false, false);
+		lru_cache_add_active_or_unevictable(page, vma);
+		page = NULL;
+	}
+	set_pte_at(mm, address, pte, entry);
+
+	/* No need to invalidate - it was non-present before */
+	update_mmu_cache(vma, address, pte);
+	ret = 0;
+
+out_ptl:
+	spin_unlock(ptl);
+out_unmap:
+	pte_unmap(pte);
+out_irq:
+	local_irq_enable();
+out_rcu:
+	rcu_read_unlock();
+	if (page) {
+		mem_cgroup_cancel_charge(page, memcg, false);
+		put_page(page);
+	}
+	return ret;
+}
+#endif /* CONFIG_SPECULATIVE_PAGE_FAULT */
+
 #ifndef __PAGETABLE_PUD_FOLDED
 /*
  * Allocate page upper directory.
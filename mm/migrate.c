@@ -40,6 +40,7 @@
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/page_owner.h>
+#include <linux/memory.h>
 
 #include <asm/tlbflush.h>
 
@@ -2056,4 +2057,143 @@ out_unlock:
 }
 #endif /* CONFIG_NUMA_BALANCING */
 
+/*
+ * Reclaim-driven demotion: when reclaim runs on a node with a slower
+ * memory tier below it, cold pages are migrated there instead of being
+ * discarded.  node_demotion[] maps each node to its demotion target,
+ * or NUMA_NO_NODE for nodes that are themselves the terminal tier.
+ */
+static int node_demotion[MAX_NUMNODES] __read_mostly = {
+	[0 ...  MAX_NUMNODES - 1] = NUMA_NO_NODE,
+};
+
+/**
+ * next_demotion_node() - Get the next node in the demotion path
+ * @node: The starting node to lookup the next node
+ *
+ * Return: node id for next memory node in the demotion path hierarchy
+ * from @node; NUMA_NO_NODE if @node is terminal.  This does not keep
+ * @node online or guarantee that it *continues* to be the next demotion
+ * target.
+ */
+int next_demotion_node(int node)
+{
+	return READ_ONCE(node_demotion[node]);
+}
+
+/*
+ * Nodes that have CPUs are the fast tier; memory-only nodes make up
+ * the slow tier.  Point every fast node at its nearest slow node and
+ * terminate the path there.  Called whenever the set of memory nodes
+ * changes; readers are unlocked and tolerate a stale target, it is
+ * revalidated when the demoted pages are allocated.
+ */
+static void establish_demotion_targets(void)
+{
+	int node, target;
+
+	for_each_node(node) {
+		int best = NUMA_NO_NODE;
+
+		if (!node_state(node, N_MEMORY) || !node_state(node, N_CPU))
+			goto set;
+
+		for_each_node_state(target, N_MEMORY) {
+			if (node_state(target, N_CPU))
+				continue;
+			if (best == NUMA_NO_NODE ||
+			    node_distance(node, target) <
+			    node_distance(node, best))
+				best = target;
+		}
+set:
+		WRITE_ONCE(node_demotion[node], best);
+	}
+}
+
+#ifdef CONFIG_MEMORY_HOTPLUG
+static int __meminit migrate_on_memory_change(struct notifier_block *self,
+					      unsigned long action, void *arg)
+{
+	switch (action) {
+	case MEM_ONLINE:
+	case MEM_OFFLINE:
+		establish_demotion_targets();
+		break;
+	}
+
+	return notifier_from_errno(0);
+}
+#endif
+
+static int __init migrate_demotion_init(void)
+{
+	establish_demotion_targets();
+	hotplug_memory_notifier(migrate_on_memory_change, 0);
+	return 0;
+}
+subsys_initcall(migrate_demotion_init);
+
+bool numa_demotion_enabled = false;
+
+#ifdef CONFIG_SYSFS
+static ssize_t numa_demotion_enabled_show(struct kobject *kobj,
+					  struct kobj_attribute *attr,
+					  char *buf)
+{
+	return sprintf(buf, "%s\n", numa_demotion_enabled ? "true" : "false");
+}
+
+static ssize_t numa_demotion_enabled_store(struct kobject *kobj,
+					   struct kobj_attribute *attr,
+					   const char *buf, size_t count)
+{
+	if (!strncmp(buf, "true", 4) || !strncmp(buf, "1", 1))
+		numa_demotion_enabled = true;
+	else if (!strncmp(buf, "false", 5) || !strncmp(buf, "0", 1))
+		numa_demotion_enabled = false;
+	else
+		return -EINVAL;
+
+	return count;
+}
+
+static struct kobj_attribute numa_demotion_enabled_attr =
+	__ATTR(demotion_enabled, 0644, numa_demotion_enabled_show,
+	       numa_demotion_enabled_store);
+
+static struct attribute *numa_attrs[] = {
+	&numa_demotion_enabled_attr.attr,
+	NULL,
+};
+
+static struct attribute_group numa_attr_group = {
+	.attrs = numa_attrs,
+};
+
+static int __init numa_init_sysfs(void)
+{
+	int err;
+	struct kobject *numa_kobj;
+
+	numa_kobj = kobject_create_and_add("numa", mm_kobj);
+	if (!numa_kobj) {
+		pr_err("failed to create numa kobject\n");
+		return -ENOMEM;
+	}
+	err = sysfs_create_group(numa_kobj, &numa_attr_group);
+	if (err) {
+		pr_err("failed to register numa group\n");
+		goto delete_obj;
+	}
+
+	return 0;
+
+delete_obj:
+	kobject_put(numa_kobj);
+	return err;
+}
+subsys_initcall(numa_init_sysfs);
+#endif /* CONFIG_SYSFS */
+
 #endif /* CONFIG_NUMA */
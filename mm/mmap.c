@@ -44,6 +44,7 @@
 #include <linux/userfaultfd_k.h>
 #include <linux/moduleparam.h>
 #include <linux/pkeys.h>
+#include <linux/btree.h>
 
 #include <asm/uaccess.h>
 #include <asm/cacheflush.h>
@@ -402,8 +403,78 @@ static inline void vma_rb_insert(struct vm_area_struct *vma,
 	rb_insert_augmented(&vma->vm_rb, root, &vma_gap_callbacks);
 }
 
+#ifdef CONFIG_VMA_RANGE_INDEX
+/*
+ * A flat, cacheline-packed B+tree mirroring the VMA set, keyed by
+ * ~vm_end so that btree_get_prev(~addr) yields the first VMA ending
+ * above addr - exactly find_vma()'s contract - in a couple of node
+ * accesses instead of a pointer chase across ~40 scattered rbtree
+ * nodes.  The rbtree remains authoritative (it also carries the gap
+ * augmentation); the index is dropped wholesale on allocation failure
+ * and lookups fall back.
+ *
+ * Writers hold mmap_sem for write.  Keys never change behind our
+ * back: stack expansion only moves vm_start, and the index is not
+ * available on STACK_GROWSUP architectures.
+ */
+static void vma_idx_insert(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	unsigned long key = ~vma->vm_end;
+
+	if (unlikely(!mm->vma_idx_live))
+		return;
+	/*
+	 * When __vma_adjust() grows a VMA over its successor(s) the new
+	 * vm_end can match that of a VMA which is unlinked only later
+	 * in the same adjustment; displace such an entry rather than
+	 * shadowing it (its own removal then finds a foreign entry
+	 * under the key and leaves it alone).
+	 */
+	btree_remove(&mm->vma_idx, &btree_geo32, &key);
+	/*
+	 * Atomic: we may sit under i_mmap_rwsem or the anon_vma lock.
+	 * On failure the index goes permanently stale for this mm and
+	 * find_vma() reverts to the rbtree.
+	 */
+	if (btree_insert(&mm->vma_idx, &btree_geo32, &key, vma,
+			 GFP_NOWAIT | __GFP_NOWARN))
+		mm->vma_idx_live = false;
+}
+
+static void vma_idx_remove(struct mm_struct *mm, struct vm_area_struct *vma)
+{
+	unsigned long key = ~vma->vm_end;
+
+	if (unlikely(!mm->vma_idx_live))
+		return;
+	/*
+	 * The entry under this key may belong to a VMA that
+	 * __vma_adjust() has just grown to our old vm_end and re-keyed
+	 * here; btree_remove() matches on the key alone, so removing
+	 * blindly would delete the live entry and find_vma() would
+	 * report the merged range unmapped.  Only remove our own.
+	 */
+	if (btree_lookup(&mm->vma_idx, &btree_geo32, &key) == vma)
+		btree_remove(&mm->vma_idx, &btree_geo32, &key);
+}
+
+static struct vm_area_struct *vma_idx_find(struct mm_struct *mm,
+					   unsigned long addr)
+{
+	unsigned long key = ~addr;
+
+	return btree_get_prev(&mm->vma_idx, &btree_geo32, &key);
+}
+#else
+static inline void vma_idx_insert(struct mm_struct *mm,
+				  struct vm_area_struct *vma) { }
+static inline void vma_idx_remove(struct mm_struct *mm,
+				  struct vm_area_struct *vma) { }
+#endif /* CONFIG_VMA_RANGE_INDEX */
+
 static void __vma_rb_erase(struct vm_area_struct *vma, struct rb_root *root)
 {
+	vma_idx_remove(vma->vm_mm, vma);
 	/*
 	 * Note rb_erase_augmented is a fairly large inline function,
 	 * so make sure we instantiate it only once with our desired
@@ -554,6 +625,7 @@ void __vma_link_rb(struct mm_struct *mm, struct vm_area_struct *vma,
 	vma->rb_subtree_gap = 0;
 	vma_gap_update(vma);
 	vma_rb_insert(vma, &mm->mm_rb);
+	vma_idx_insert(mm, vma);
 }
 
 static void __vma_link_file(struct vm_area_struct *vma)
@@ -595,7 +667,9 @@ static void vma_link(struct mm_struct *mm, struct vm_area_struct *vma,
 		i_mmap_lock_write(mapping);
 	}
 
+	mm_seq_write_begin(mm);
 	__vma_link(mm, vma, prev, rb_link, rb_parent);
+	mm_seq_write_end(mm);
 	__vma_link_file(vma);
 
 	if (mapping)
@@ -759,6 +833,8 @@ int __vma_adjust(struct vm_area_struct *vma, unsigned long start,
 				return error;
 		}
 	}
+
+	mm_seq_write_begin(mm);
 again:
 	vma_adjust_trans_huge(orig_vma, start, end, adjust_next);
 
@@ -806,7 +882,10 @@ again:
 		start_changed = true;
 	}
 	if (end != vma->vm_end) {
+		/* vm_end is the index key: re-insert under the new one */
+		vma_idx_remove(mm, vma);
 		vma->vm_end = end;
+		vma_idx_insert(mm, vma);
 		end_changed = true;
 	}
 	vma->vm_pgoff = pgoff;
@@ -942,6 +1021,7 @@ again:
 			VM_WARN_ON(mm->highest_vm_end != end);
 		}
 	}
+	mm_seq_write_end(mm);
 	if (insert && file)
 		uprobe_mmap(insert);
 
@@ -1713,6 +1793,15 @@ out:
 	if (file)
 		uprobe_mmap(vma);
 
+	/*
+	 * Read-only file mappings are collapse candidates for khugepaged:
+	 * make sure the mm is on its scan list. Anonymous and shmem vmas
+	 * register themselves on their own fault paths.
+	 */
+	if (IS_ENABLED(CONFIG_READ_ONLY_THP_FOR_FS) && file &&
+	    !(vm_flags & (VM_MAYWRITE | VM_SPECIAL)))
+		khugepaged_enter(vma, vm_flags);
+
 	/*
 	 * New (or expanded) vma always get soft dirty status.
 	 * Otherwise user-space soft-dirty page tracker won't
@@ -2095,6 +2184,16 @@ struct vm_area_struct *find_vma(struct mm_struct *mm, unsigned long addr)
 	struct rb_node *rb_node;
 	struct vm_area_struct *vma;
 
+#ifdef CONFIG_VMA_RANGE_INDEX
+	/*
+	 * The packed index resolves the lookup in O(log n) cacheline
+	 * accesses and, unlike the vmacache, doesn't degrade under
+	 * thread migration.  A NULL result is authoritative.
+	 */
+	if (likely(mm->vma_idx_live))
+		return vma_idx_find(mm, addr);
+#endif
+
 	/* Check the cache first. */
 	vma = vmacache_find(mm, addr);
 	if (likely(vma))
@@ -2476,6 +2575,7 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 
 	insertion_point = (prev ? &prev->vm_next : &mm->mmap);
 	vma->vm_prev = NULL;
+	mm_seq_write_begin(mm);
 	do {
 		vma_rb_erase(vma, &mm->mm_rb);
 		mm->map_count--;
@@ -2489,6 +2589,7 @@ detach_vmas_to_be_unmapped(struct mm_struct *mm, struct vm_area_struct *vma,
 	} else
 		mm->highest_vm_end = prev ? prev->vm_end : 0;
 	tail_vma->vm_next = NULL;
+	mm_seq_write_end(mm);
 
 	/* Kill the cache */
 	vmacache_invalidate(mm);
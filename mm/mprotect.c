@@ -328,9 +328,11 @@ success:
 	 * vm_flags and vm_page_prot are protected by the mmap_sem
 	 * held in write mode.
 	 */
+	mm_seq_write_begin(mm);
 	vma->vm_flags = newflags;
 	dirty_accountable = vma_wants_writenotify(vma, vma->vm_page_prot);
 	vma_set_page_prot(vma);
+	mm_seq_write_end(mm);
 
 	change_protection(vma, start, end, vma->vm_page_prot,
 			  dirty_accountable, 0);
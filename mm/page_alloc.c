@@ -1433,40 +1433,20 @@ static inline void __init pgdat_init_report_one_done(void)
 		complete(&pgdat_init_all_done_comp);
 }
 
-/* Initialise remaining memory on a node */
-static int __init deferred_init_memmap(void *data)
+/*
+ * Initialise and free the struct pages in [first_init_pfn, last_pfn)
+ * within the deferred zone.  Returns the number of pages handed to the
+ * page allocator.  Ranges given to different threads must be aligned
+ * to MAX_ORDER_NR_PAGES so that no pageblock straddles two workers.
+ */
+static unsigned long __init deferred_init_range(int nid, struct zone *zone,
+						unsigned long first_init_pfn,
+						unsigned long last_pfn)
 {
-	pg_data_t *pgdat = data;
-	int nid = pgdat->node_id;
 	struct mminit_pfnnid_cache nid_init_state = { };
-	unsigned long start = jiffies;
 	unsigned long nr_pages = 0;
 	unsigned long walk_start, walk_end;
-	int i, zid;
-	struct zone *zone;
-	unsigned long first_init_pfn = pgdat->first_deferred_pfn;
-	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
-
-	if (first_init_pfn == ULONG_MAX) {
-		pgdat_init_report_one_done();
-		return 0;
-	}
-
-	/* Bind memory initialisation thread to a local node if possible */
-	if (!cpumask_empty(cpumask))
-		set_cpus_allowed_ptr(current, cpumask);
-
-	/* Sanity check boundaries */
-	BUG_ON(pgdat->first_deferred_pfn < pgdat->node_start_pfn);
-	BUG_ON(pgdat->first_deferred_pfn > pgdat_end_pfn(pgdat));
-	pgdat->first_deferred_pfn = ULONG_MAX;
-
-	/* Only the highest zone is deferred so find it */
-	for (zid = 0; zid < MAX_NR_ZONES; zid++) {
-		zone = pgdat->node_zones + zid;
-		if (first_init_pfn < zone_end_pfn(zone))
-			break;
-	}
+	int i;
 
 	for_each_mem_pfn_range(i, nid, &walk_start, &walk_end, NULL) {
 		unsigned long pfn, end_pfn;
@@ -1475,7 +1455,7 @@ static int __init deferred_init_memmap(void *data)
 		unsigned long free_base_pfn = 0;
 		int nr_to_free = 0;
 
-		end_pfn = min(walk_end, zone_end_pfn(zone));
+		end_pfn = min3(walk_end, zone_end_pfn(zone), last_pfn);
 		pfn = first_init_pfn;
 		if (pfn < walk_start)
 			pfn = walk_start;
@@ -1546,6 +1526,113 @@ free_range:
 		first_init_pfn = max(end_pfn, first_init_pfn);
 	}
 
+	return nr_pages;
+}
+
+struct deferred_init_work {
+	int nid;
+	struct zone *zone;
+	unsigned long start_pfn;
+	unsigned long end_pfn;
+	unsigned long nr_pages;
+	struct completion done;
+};
+
+static int __init deferred_init_worker(void *data)
+{
+	struct deferred_init_work *w = data;
+	const struct cpumask *cpumask = cpumask_of_node(w->nid);
+
+	/* Keep the worker on the node it is initialising */
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	w->nr_pages = deferred_init_range(w->nid, w->zone, w->start_pfn,
+					  w->end_pfn);
+	complete(&w->done);
+	return 0;
+}
+
+/* Initialise remaining memory on a node */
+static int __init deferred_init_memmap(void *data)
+{
+	pg_data_t *pgdat = data;
+	int nid = pgdat->node_id;
+	unsigned long start = jiffies;
+	unsigned long nr_pages = 0;
+	unsigned long chunk, span;
+	int zid, t, nr_threads;
+	struct deferred_init_work *works = NULL;
+	struct zone *zone;
+	unsigned long first_init_pfn = pgdat->first_deferred_pfn;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (first_init_pfn == ULONG_MAX) {
+		pgdat_init_report_one_done();
+		return 0;
+	}
+
+	/* Bind memory initialisation thread to a local node if possible */
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	/* Sanity check boundaries */
+	BUG_ON(pgdat->first_deferred_pfn < pgdat->node_start_pfn);
+	BUG_ON(pgdat->first_deferred_pfn > pgdat_end_pfn(pgdat));
+	pgdat->first_deferred_pfn = ULONG_MAX;
+
+	/* Only the highest zone is deferred so find it */
+	for (zid = 0; zid < MAX_NR_ZONES; zid++) {
+		zone = pgdat->node_zones + zid;
+		if (first_init_pfn < zone_end_pfn(zone))
+			break;
+	}
+
+	/*
+	 * Spread the work over the CPUs of this node; memmap init is
+	 * memory-bandwidth bound, so one thread per CPU is an upper
+	 * bound, not a target.
+	 */
+	span = zone_end_pfn(zone) - first_init_pfn;
+	nr_threads = max_t(int, 1, cpumask_weight(cpumask));
+	chunk = ALIGN(DIV_ROUND_UP(span, nr_threads), MAX_ORDER_NR_PAGES);
+	nr_threads = DIV_ROUND_UP(span, chunk);
+
+	if (nr_threads > 1)
+		works = kcalloc(nr_threads - 1, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		nr_threads = 1;
+
+	for (t = 1; t < nr_threads; t++) {
+		struct deferred_init_work *w = &works[t - 1];
+		struct task_struct *tsk;
+
+		w->nid = nid;
+		w->zone = zone;
+		w->start_pfn = first_init_pfn + t * chunk;
+		w->end_pfn = min(w->start_pfn + chunk, zone_end_pfn(zone));
+		init_completion(&w->done);
+
+		tsk = kthread_run(deferred_init_worker, w, "pgdatinit%d.%d",
+				  nid, t);
+		if (IS_ERR(tsk)) {
+			/* do the worker's share ourselves below */
+			w->nr_pages = deferred_init_range(nid, zone,
+						w->start_pfn, w->end_pfn);
+			complete(&w->done);
+		}
+	}
+
+	nr_pages = deferred_init_range(nid, zone, first_init_pfn,
+			nr_threads > 1 ? first_init_pfn + chunk :
+					 zone_end_pfn(zone));
+
+	for (t = 1; t < nr_threads; t++) {
+		wait_for_completion(&works[t - 1].done);
+		nr_pages += works[t - 1].nr_pages;
+	}
+	kfree(works);
+
 	/* Sanity check that the next zone really is unpopulated */
 	WARN_ON(++zid < MAX_NR_ZONES && populated_zone(++zone));
 
@@ -3808,6 +3895,99 @@ out:
 }
 EXPORT_SYMBOL(__alloc_pages_nodemask);
 
+/*
+ * __alloc_pages_bulk - Allocate a number of order-0 pages to a list
+ * @gfp_mask: GFP flags for the allocation
+ * @zonelist: The zonelist to allocate from
+ * @nodemask: Set of nodes to allocate from, may be NULL
+ * @nr_pages: The number of pages desired on the list
+ * @page_list: List to store the allocated pages
+ *
+ * This is a batched version of the page allocator that attempts to
+ * allocate nr_pages quickly and add them to a list.  The entire
+ * per-cpu pageset manipulation happens under a single IRQ-disabled
+ * section instead of once per page, so high-rate consumers (RX ring
+ * refill, readahead) do not pay the allocator entry costs per page.
+ *
+ * Only the preferred zone is attempted, and only above the low
+ * watermark; any shortfall is left to the caller, which can fill the
+ * remainder through the normal single-page path with its full
+ * reclaim/fallback machinery.
+ *
+ * Returns the number of pages added to the list.
+ */
+unsigned long __alloc_pages_bulk(gfp_t gfp_mask, struct zonelist *zonelist,
+				 nodemask_t *nodemask, int nr_pages,
+				 struct list_head *page_list)
+{
+	struct page *page;
+	struct zone *zone;
+	struct per_cpu_pages *pcp;
+	struct list_head *list;
+	unsigned long flags;
+	unsigned long allocated = 0;
+	struct alloc_context ac = {
+		.high_zoneidx = gfp_zone(gfp_mask),
+		.zonelist = zonelist,
+		.nodemask = nodemask,
+		.migratetype = gfpflags_to_migratetype(gfp_mask),
+	};
+
+	if (WARN_ON_ONCE(nr_pages <= 0))
+		return 0;
+
+	gfp_mask &= gfp_allowed_mask;
+
+	ac.preferred_zoneref = first_zones_zonelist(ac.zonelist,
+					ac.high_zoneidx, ac.nodemask);
+	zone = ac.preferred_zoneref->zone;
+	if (!zone)
+		return 0;
+
+	if (!zone_watermark_fast(zone, 0, low_wmark_pages(zone) + nr_pages,
+				 zonelist_zone_idx(ac.preferred_zoneref),
+				 ALLOC_WMARK_LOW))
+		return 0;
+
+	local_irq_save(flags);
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list = &pcp->lists[ac.migratetype];
+
+	while (allocated < nr_pages) {
+		if (list_empty(list)) {
+			pcp->count += rmqueue_bulk(zone, 0, pcp->batch,
+						   list, ac.migratetype,
+						   false);
+			if (unlikely(list_empty(list)))
+				break;
+		}
+
+		page = list_first_entry(list, struct page, lru);
+		list_del(&page->lru);
+		pcp->count--;
+
+		if (unlikely(check_new_pcp(page)))
+			continue;
+
+		/*
+		 * prep_new_page() usually runs with IRQs enabled, but
+		 * it is cheap enough that keeping it inside the batch
+		 * beats re-walking the list afterwards.
+		 */
+		prep_new_page(page, 0, gfp_mask, 0);
+		zone_statistics(zone, zone, gfp_mask);
+		list_add_tail(&page->lru, page_list);
+		allocated++;
+	}
+
+	if (allocated)
+		__count_zid_vm_events(PGALLOC, zone_idx(zone), allocated);
+	local_irq_restore(flags);
+
+	return allocated;
+}
+EXPORT_SYMBOL_GPL(__alloc_pages_bulk);
+
 /*
  * Common helper functions.
  */
@@ -4293,6 +4473,8 @@ void show_free_areas(unsigned int filter)
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 			" shmem_thp: %lukB"
 			" shmem_pmdmapped: %lukB"
+			" file_thp: %lukB"
+			" file_pmdmapped: %lukB"
 			" anon_thp: %lukB"
 #endif
 			" writeback_tmp:%lukB"
@@ -4315,6 +4497,9 @@ void show_free_areas(unsigned int filter)
 			K(node_page_state(pgdat, NR_SHMEM_THPS) * HPAGE_PMD_NR),
 			K(node_page_state(pgdat, NR_SHMEM_PMDMAPPED)
 					* HPAGE_PMD_NR),
+			K(node_page_state(pgdat, NR_FILE_THPS) * HPAGE_PMD_NR),
+			K(node_page_state(pgdat, NR_FILE_PMDMAPPED)
+					* HPAGE_PMD_NR),
 			K(node_page_state(pgdat, NR_ANON_THPS) * HPAGE_PMD_NR),
 #endif
 			K(node_page_state(pgdat, NR_SHMEM)),
@@ -35,11 +35,14 @@
  * area in the chunk.  This helps the allocator not to iterate the
  * chunk maps unnecessarily.
  *
- * Allocation state in each chunk is kept using an array of integers
- * on chunk->map.  A positive value in the map represents a free
- * region and negative allocated.  Allocation inside a chunk is done
- * by scanning this map sequentially and serving the first matching
- * entry.  This is mostly copied from the percpu_modalloc() allocator.
+ * Allocation state in each chunk is kept using two bitmaps with one
+ * bit per PCPU_MIN_ALLOC_SIZE bytes.  chunk->alloc_map has a bit set
+ * for each allocated allocation unit and chunk->bound_map has a bit
+ * set at the start of each allocated area so that the area length can
+ * be recovered on free.  Allocation inside a chunk is done by
+ * scanning the free runs of alloc_map and serving the first fitting
+ * one; the per-chunk first_free and contig_hint fields keep those
+ * scans short regardless of how many areas a chunk carries.
  * Chunks can be determined from the address using the index field
  * in the page struct. The index field contains a pointer to the chunk.
  *
@@ -77,9 +80,6 @@
 #include <asm/io.h>
 
 #define PCPU_SLOT_BASE_SHIFT		5	/* 1-31 shares the same slot */
-#define PCPU_DFL_MAP_ALLOC		16	/* start a map with 16 ents */
-#define PCPU_ATOMIC_MAP_MARGIN_LOW	32
-#define PCPU_ATOMIC_MAP_MARGIN_HIGH	64
 #define PCPU_EMPTY_POP_PAGES_LOW	2
 #define PCPU_EMPTY_POP_PAGES_HIGH	4
 
@@ -109,13 +109,11 @@ struct pcpu_chunk {
 	int			contig_hint;	/* max contiguous size hint */
 	void			*base_addr;	/* base address of this chunk */
 
-	int			map_used;	/* # of map entries used before the sentry */
-	int			map_alloc;	/* # of map entries allocated */
-	int			*map;		/* allocation map */
-	struct list_head	map_extend_list;/* on pcpu_map_extend_chunks */
+	unsigned long		*alloc_map;	/* allocation map */
+	unsigned long		*bound_map;	/* boundary map */
 
 	void			*data;		/* chunk data */
-	int			first_free;	/* no free below this */
+	int			first_free;	/* no free bit below this */
 	bool			immutable;	/* no [de]population allowed */
 	int			nr_populated;	/* # of populated pages */
 	unsigned long		populated[];	/* populated bitmap */
@@ -162,13 +160,10 @@ static struct pcpu_chunk *pcpu_reserved_chunk;
 static int pcpu_reserved_chunk_limit;
 
 static DEFINE_SPINLOCK(pcpu_lock);	/* all internal data structures */
-static DEFINE_MUTEX(pcpu_alloc_mutex);	/* chunk create/destroy, [de]pop, map ext */
+static DEFINE_MUTEX(pcpu_alloc_mutex);	/* chunk create/destroy, [de]pop */
 
 static struct list_head *pcpu_slot __read_mostly; /* chunk list slots */
 
-/* chunks which need their map areas extended, protected by pcpu_lock */
-static LIST_HEAD(pcpu_map_extend_chunks);
-
 /*
  * The number of empty populated pages, protected by pcpu_lock.  The
  * reserved chunk doesn't contribute to the count.
@@ -228,6 +223,12 @@ static int pcpu_chunk_slot(const struct pcpu_chunk *chunk)
 	return pcpu_size_to_slot(chunk->free_size);
 }
 
+/* number of PCPU_MIN_ALLOC_SIZE units tracked by a chunk's bitmaps */
+static int pcpu_unit_map_bits(void)
+{
+	return pcpu_unit_size >> PCPU_MIN_ALLOC_SHIFT;
+}
+
 /* set the pointer to a chunk in a page struct */
 static void pcpu_set_page_chunk(struct page *page, struct pcpu_chunk *pcpu)
 {
@@ -321,33 +322,31 @@ static void pcpu_mem_free(void *ptr)
 /**
  * pcpu_count_occupied_pages - count the number of pages an area occupies
  * @chunk: chunk of interest
- * @i: index of the area in question
+ * @bit_off: start offset of the area in allocation units
+ * @bits: size of the area in allocation units
  *
- * Count the number of pages chunk's @i'th area occupies.  When the area's
- * start and/or end address isn't aligned to page boundary, the straddled
+ * Count the number of pages the area [@bit_off, @bit_off + @bits) has to
+ * itself, ie. pages in the span which carry no other allocation.  When the
+ * area's start and/or end isn't aligned to page boundary, the straddled
  * page is included in the count iff the rest of the page is free.
+ *
+ * Call this before marking the area allocated or after clearing it so
+ * that the area's own units read as free.
  */
-static int pcpu_count_occupied_pages(struct pcpu_chunk *chunk, int i)
+static int pcpu_count_occupied_pages(struct pcpu_chunk *chunk, int bit_off,
+				     int bits)
 {
-	int off = chunk->map[i] & ~1;
-	int end = chunk->map[i + 1] & ~1;
+	const int bpp = PAGE_SIZE >> PCPU_MIN_ALLOC_SHIFT;
+	int page_start = PFN_DOWN(bit_off << PCPU_MIN_ALLOC_SHIFT);
+	int page_end = PFN_UP((bit_off + bits) << PCPU_MIN_ALLOC_SHIFT);
+	int page, pages = 0;
 
-	if (!PAGE_ALIGNED(off) && i > 0) {
-		int prev = chunk->map[i - 1];
+	for (page = page_start; page < page_end; page++)
+		if (find_next_bit(chunk->alloc_map, (page + 1) * bpp,
+				  page * bpp) >= (page + 1) * bpp)
+			pages++;
 
-		if (!(prev & 1) && prev <= round_down(off, PAGE_SIZE))
-			off = round_down(off, PAGE_SIZE);
-	}
-
-	if (!PAGE_ALIGNED(end) && i + 1 < chunk->map_used) {
-		int next = chunk->map[i + 1];
-		int nend = chunk->map[i + 2] & ~1;
-
-		if (!(next & 1) && nend >= round_up(end, PAGE_SIZE))
-			end = round_up(end, PAGE_SIZE);
-	}
-
-	return max_t(int, PFN_DOWN(end) - PFN_UP(off), 0);
+	return pages;
 }
 
 /**
@@ -376,155 +375,31 @@ static void pcpu_chunk_relocate(struct pcpu_chunk *chunk, int oslot)
 }
 
 /**
- * pcpu_need_to_extend - determine whether chunk area map needs to be extended
+ * pcpu_is_populated - determine whether an area is fully populated
  * @chunk: chunk of interest
- * @is_atomic: the allocation context
- *
- * Determine whether area map of @chunk needs to be extended.  If
- * @is_atomic, only the amount necessary for a new allocation is
- * considered; however, async extension is scheduled if the left amount is
- * low.  If !@is_atomic, it aims for more empty space.  Combined, this
- * ensures that the map is likely to have enough available space to
- * accomodate atomic allocations which can't extend maps directly.
- *
- * CONTEXT:
- * pcpu_lock.
- *
- * RETURNS:
- * New target map allocation length if extension is necessary, 0
- * otherwise.
+ * @bit_off: start offset of the area in allocation units
+ * @bits: size of the area in allocation units
+ * @next_off: out param for the next scan candidate on failure
+ *
+ * Check whether the area [@bit_off, @bit_off + @bits) lies entirely in
+ * the populated region of @chunk.  If it doesn't, @next_off is set to
+ * the first allocation unit past the offending unpopulated region so
+ * that the caller can resume scanning from there.
  */
-static int pcpu_need_to_extend(struct pcpu_chunk *chunk, bool is_atomic)
+static bool pcpu_is_populated(struct pcpu_chunk *chunk, int bit_off, int bits,
+			      int *next_off)
 {
-	int margin, new_alloc;
-
-	lockdep_assert_held(&pcpu_lock);
+	int page_start = PFN_DOWN(bit_off << PCPU_MIN_ALLOC_SHIFT);
+	int page_end = PFN_UP((bit_off + bits) << PCPU_MIN_ALLOC_SHIFT);
+	int rs, re;
 
-	if (is_atomic) {
-		margin = 3;
+	rs = page_start;
+	pcpu_next_unpop(chunk, &rs, &re, page_end);
+	if (rs >= page_end)
+		return true;
 
-		if (chunk->map_alloc <
-		    chunk->map_used + PCPU_ATOMIC_MAP_MARGIN_LOW) {
-			if (list_empty(&chunk->map_extend_list)) {
-				list_add_tail(&chunk->map_extend_list,
-					      &pcpu_map_extend_chunks);
-				pcpu_schedule_balance_work();
-			}
-		}
-	} else {
-		margin = PCPU_ATOMIC_MAP_MARGIN_HIGH;
-	}
-
-	if (chunk->map_alloc >= chunk->map_used + margin)
-		return 0;
-
-	new_alloc = PCPU_DFL_MAP_ALLOC;
-	while (new_alloc < chunk->map_used + margin)
-		new_alloc *= 2;
-
-	return new_alloc;
-}
-
-/**
- * pcpu_extend_area_map - extend area map of a chunk
- * @chunk: chunk of interest
- * @new_alloc: new target allocation length of the area map
- *
- * Extend area map of @chunk to have @new_alloc entries.
- *
- * CONTEXT:
- * Does GFP_KERNEL allocation.  Grabs and releases pcpu_lock.
- *
- * RETURNS:
- * 0 on success, -errno on failure.
- */
-static int pcpu_extend_area_map(struct pcpu_chunk *chunk, int new_alloc)
-{
-	int *old = NULL, *new = NULL;
-	size_t old_size = 0, new_size = new_alloc * sizeof(new[0]);
-	unsigned long flags;
-
-	lockdep_assert_held(&pcpu_alloc_mutex);
-
-	new = pcpu_mem_zalloc(new_size);
-	if (!new)
-		return -ENOMEM;
-
-	/* acquire pcpu_lock and switch to new area map */
-	spin_lock_irqsave(&pcpu_lock, flags);
-
-	if (new_alloc <= chunk->map_alloc)
-		goto out_unlock;
-
-	old_size = chunk->map_alloc * sizeof(chunk->map[0]);
-	old = chunk->map;
-
-	memcpy(new, old, old_size);
-
-	chunk->map_alloc = new_alloc;
-	chunk->map = new;
-	new = NULL;
-
-out_unlock:
-	spin_unlock_irqrestore(&pcpu_lock, flags);
-
-	/*
-	 * pcpu_mem_free() might end up calling vfree() which uses
-	 * IRQ-unsafe lock and thus can't be called under pcpu_lock.
-	 */
-	pcpu_mem_free(old);
-	pcpu_mem_free(new);
-
-	return 0;
-}
-
-/**
- * pcpu_fit_in_area - try to fit the requested allocation in a candidate area
- * @chunk: chunk the candidate area belongs to
- * @off: the offset to the start of the candidate area
- * @this_size: the size of the candidate area
- * @size: the size of the target allocation
- * @align: the alignment of the target allocation
- * @pop_only: only allocate from already populated region
- *
- * We're trying to allocate @size bytes aligned at @align.  @chunk's area
- * at @off sized @this_size is a candidate.  This function determines
- * whether the target allocation fits in the candidate area and returns the
- * number of bytes to pad after @off.  If the target area doesn't fit, -1
- * is returned.
- *
- * If @pop_only is %true, this function only considers the already
- * populated part of the candidate area.
- */
-static int pcpu_fit_in_area(struct pcpu_chunk *chunk, int off, int this_size,
-			    int size, int align, bool pop_only)
-{
-	int cand_off = off;
-
-	while (true) {
-		int head = ALIGN(cand_off, align) - off;
-		int page_start, page_end, rs, re;
-
-		if (this_size < head + size)
-			return -1;
-
-		if (!pop_only)
-			return head;
-
-		/*
-		 * If the first unpopulated page is beyond the end of the
-		 * allocation, the whole allocation is populated;
-		 * otherwise, retry from the end of the unpopulated area.
-		 */
-		page_start = PFN_DOWN(head + off);
-		page_end = PFN_UP(head + off + size);
-
-		rs = page_start;
-		pcpu_next_unpop(chunk, &rs, &re, PFN_UP(off + this_size));
-		if (rs >= page_end)
-			return head;
-		cand_off = re * PAGE_SIZE;
-	}
+	*next_off = re << (PAGE_SHIFT - PCPU_MIN_ALLOC_SHIFT);
+	return false;
 }
 
 /**
@@ -539,7 +414,11 @@ static int pcpu_fit_in_area(struct pcpu_chunk *chunk, int off, int this_size,
  * Note that this function only allocates the offset.  It doesn't
  * populate or map the area.
  *
- * @chunk->map must have at least two free slots.
+ * The scan starts at @chunk->first_free and walks the free runs of
+ * the allocation bitmap.  If the scan reaches the end of the chunk
+ * without finding a fit, it has seen every free run and makes
+ * @chunk->contig_hint exact; otherwise the hint is left as an upper
+ * bound.
  *
  * CONTEXT:
  * pcpu_lock.
@@ -551,103 +430,55 @@ static int pcpu_fit_in_area(struct pcpu_chunk *chunk, int off, int this_size,
 static int pcpu_alloc_area(struct pcpu_chunk *chunk, int size, int align,
 			   bool pop_only, int *occ_pages_p)
 {
+	const int total = pcpu_unit_map_bits();
 	int oslot = pcpu_chunk_slot(chunk);
+	int bits = size >> PCPU_MIN_ALLOC_SHIFT;
+	int align_bits = max_t(int, align >> PCPU_MIN_ALLOC_SHIFT, 1);
 	int max_contig = 0;
-	int i, off;
-	bool seen_free = false;
-	int *p;
+	int bit_off, bit_end, off = -1;
 
-	for (i = chunk->first_free, p = chunk->map + i; i < chunk->map_used; i++, p++) {
-		int head, tail;
-		int this_size;
+	lockdep_assert_held(&pcpu_lock);
 
-		off = *p;
-		if (off & 1)
-			continue;
+	for (bit_off = find_next_zero_bit(chunk->alloc_map, total,
+					  chunk->first_free);
+	     bit_off < total;
+	     bit_off = find_next_zero_bit(chunk->alloc_map, total, bit_end)) {
+		int cand = ALIGN(bit_off, align_bits);
 
-		this_size = (p[1] & ~1) - off;
+		bit_end = find_next_bit(chunk->alloc_map, total, bit_off + 1);
+		max_contig = max(bit_end - bit_off, max_contig);
 
-		head = pcpu_fit_in_area(chunk, off, this_size, size, align,
-					pop_only);
-		if (head < 0) {
-			if (!seen_free) {
-				chunk->first_free = i;
-				seen_free = true;
-			}
-			max_contig = max(this_size, max_contig);
-			continue;
-		}
+		while (cand + bits <= bit_end) {
+			int next;
 
-		/*
-		 * If head is small or the previous block is free,
-		 * merge'em.  Note that 'small' is defined as smaller
-		 * than sizeof(int), which is very small but isn't too
-		 * uncommon for percpu allocations.
-		 */
-		if (head && (head < sizeof(int) || !(p[-1] & 1))) {
-			*p = off += head;
-			if (p[-1] & 1)
-				chunk->free_size -= head;
-			else
-				max_contig = max(*p - p[-1], max_contig);
-			this_size -= head;
-			head = 0;
-		}
-
-		/* if tail is small, just keep it around */
-		tail = this_size - head - size;
-		if (tail < sizeof(int)) {
-			tail = 0;
-			size = this_size - head;
-		}
-
-		/* split if warranted */
-		if (head || tail) {
-			int nr_extra = !!head + !!tail;
-
-			/* insert new subblocks */
-			memmove(p + nr_extra + 1, p + 1,
-				sizeof(chunk->map[0]) * (chunk->map_used - i));
-			chunk->map_used += nr_extra;
-
-			if (head) {
-				if (!seen_free) {
-					chunk->first_free = i;
-					seen_free = true;
-				}
-				*++p = off += head;
-				++i;
-				max_contig = max(head, max_contig);
-			}
-			if (tail) {
-				p[1] = off + size;
-				max_contig = max(tail, max_contig);
+			if (!pop_only ||
+			    pcpu_is_populated(chunk, cand, bits, &next)) {
+				off = cand;
+				goto found;
 			}
+			cand = ALIGN(next, align_bits);
 		}
-
-		if (!seen_free)
-			chunk->first_free = i + 1;
-
-		/* update hint and mark allocated */
-		if (i + 1 == chunk->map_used)
-			chunk->contig_hint = max_contig; /* fully scanned */
-		else
-			chunk->contig_hint = max(chunk->contig_hint,
-						 max_contig);
-
-		chunk->free_size -= size;
-		*p |= 1;
-
-		*occ_pages_p = pcpu_count_occupied_pages(chunk, i);
-		pcpu_chunk_relocate(chunk, oslot);
-		return off;
 	}
 
-	chunk->contig_hint = max_contig;	/* fully scanned */
+	/* fully scanned, the hint is now exact */
+	chunk->contig_hint = max_contig << PCPU_MIN_ALLOC_SHIFT;
 	pcpu_chunk_relocate(chunk, oslot);
 
 	/* tell the upper layer that this chunk has no matching area */
 	return -1;
+
+found:
+	*occ_pages_p = pcpu_count_occupied_pages(chunk, off, bits);
+
+	bitmap_set(chunk->alloc_map, off, bits);
+	set_bit(off, chunk->bound_map);
+
+	chunk->free_size -= size;
+	chunk->first_free = find_next_zero_bit(chunk->alloc_map, total,
+					       chunk->first_free);
+
+	pcpu_chunk_relocate(chunk, oslot);
+	return off << PCPU_MIN_ALLOC_SHIFT;
 }
 
 /**
@@ -657,8 +488,8 @@ static int pcpu_alloc_area(struct pcpu_chunk *chunk, int size, int align,
  * @occ_pages_p: out param for the number of pages the area occupies
  *
  * Free area starting from @freeme to @chunk.  Note that this function
- * only modifies the allocation map.  It doesn't depopulate or unmap
- * the area.
+ * only modifies the allocation bitmaps.  It doesn't depopulate or
+ * unmap the area.
  *
  * CONTEXT:
  * pcpu_lock.
@@ -666,53 +497,41 @@ static int pcpu_alloc_area(struct pcpu_chunk *chunk, int size, int align,
 static void pcpu_free_area(struct pcpu_chunk *chunk, int freeme,
 			   int *occ_pages_p)
 {
+	const int total = pcpu_unit_map_bits();
 	int oslot = pcpu_chunk_slot(chunk);
-	int off = 0;
-	unsigned i, j;
-	int to_free = 0;
-	int *p;
-
-	freeme |= 1;	/* we are searching for <given offset, in use> pair */
-
-	i = 0;
-	j = chunk->map_used;
-	while (i != j) {
-		unsigned k = (i + j) / 2;
-		off = chunk->map[k];
-		if (off < freeme)
-			i = k + 1;
-		else if (off > freeme)
-			j = k;
-		else
-			i = j = k;
-	}
-	BUG_ON(off != freeme);
+	int bit_off = freeme >> PCPU_MIN_ALLOC_SHIFT;
+	int bit_end, bits, rs, re;
+
+	lockdep_assert_held(&pcpu_lock);
+
+	BUG_ON(!test_bit(bit_off, chunk->bound_map) ||
+	       !test_bit(bit_off, chunk->alloc_map));
 
-	if (i < chunk->first_free)
-		chunk->first_free = i;
+	/*
+	 * The area ends at the next allocation boundary or the next
+	 * free unit, whichever comes first - adjacent allocations are
+	 * contiguous in alloc_map and only separable by bound_map.
+	 */
+	bit_end = min(find_next_bit(chunk->bound_map, total, bit_off + 1),
+		      find_next_zero_bit(chunk->alloc_map, total, bit_off + 1));
+	bits = bit_end - bit_off;
 
-	p = chunk->map + i;
-	*p = off &= ~1;
-	chunk->free_size += (p[1] & ~1) - off;
+	bitmap_clear(chunk->alloc_map, bit_off, bits);
+	clear_bit(bit_off, chunk->bound_map);
 
-	*occ_pages_p = pcpu_count_occupied_pages(chunk, i);
+	chunk->free_size += bits << PCPU_MIN_ALLOC_SHIFT;
+	chunk->first_free = min(chunk->first_free, bit_off);
 
-	/* merge with next? */
-	if (!(p[1] & 1))
-		to_free++;
-	/* merge with previous? */
-	if (i > 0 && !(p[-1] & 1)) {
-		to_free++;
-		i--;
-		p--;
-	}
-	if (to_free) {
-		chunk->map_used -= to_free;
-		memmove(p + 1, p + 1 + to_free,
-			(chunk->map_used - i) * sizeof(chunk->map[0]));
-	}
+	/* extend over the now merged free run to update the hint */
+	rs = bit_off;
+	while (rs > 0 && !test_bit(rs - 1, chunk->alloc_map))
+		rs--;
+	re = find_next_bit(chunk->alloc_map, total, bit_end);
+	chunk->contig_hint = max(chunk->contig_hint,
+				 (re - rs) << PCPU_MIN_ALLOC_SHIFT);
+
+	*occ_pages_p = pcpu_count_occupied_pages(chunk, bit_off, bits);
 
-	chunk->contig_hint = max(chunk->map[i + 1] - chunk->map[i] - 1, chunk->contig_hint);
 	pcpu_chunk_relocate(chunk, oslot);
 }
 
@@ -724,20 +543,18 @@ static struct pcpu_chunk *pcpu_alloc_chunk(void)
 	if (!chunk)
 		return NULL;
 
-	chunk->map = pcpu_mem_zalloc(PCPU_DFL_MAP_ALLOC *
-						sizeof(chunk->map[0]));
-	if (!chunk->map) {
+	chunk->alloc_map = pcpu_mem_zalloc(BITS_TO_LONGS(pcpu_unit_map_bits()) *
+					   sizeof(chunk->alloc_map[0]));
+	chunk->bound_map = pcpu_mem_zalloc(BITS_TO_LONGS(pcpu_unit_map_bits()) *
+					   sizeof(chunk->bound_map[0]));
+	if (!chunk->alloc_map || !chunk->bound_map) {
+		pcpu_mem_free(chunk->alloc_map);
+		pcpu_mem_free(chunk->bound_map);
 		pcpu_mem_free(chunk);
 		return NULL;
 	}
 
-	chunk->map_alloc = PCPU_DFL_MAP_ALLOC;
-	chunk->map[0] = 0;
-	chunk->map[1] = pcpu_unit_size | 1;
-	chunk->map_used = 1;
-
 	INIT_LIST_HEAD(&chunk->list);
-	INIT_LIST_HEAD(&chunk->map_extend_list);
 	chunk->free_size = pcpu_unit_size;
 	chunk->contig_hint = pcpu_unit_size;
 
@@ -748,7 +565,8 @@ static void pcpu_free_chunk(struct pcpu_chunk *chunk)
 {
 	if (!chunk)
 		return;
-	pcpu_mem_free(chunk->map);
+	pcpu_mem_free(chunk->alloc_map);
+	pcpu_mem_free(chunk->bound_map);
 	pcpu_mem_free(chunk);
 }
 
@@ -873,18 +691,18 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 	const char *err;
 	bool is_atomic = (gfp & GFP_KERNEL) != GFP_KERNEL;
 	int occ_pages = 0;
-	int slot, off, new_alloc, cpu, ret;
+	int slot, off, cpu, ret;
 	unsigned long flags;
 	void __percpu *ptr;
 
 	/*
-	 * We want the lowest bit of offset available for in-use/free
-	 * indicator, so force >= 16bit alignment and make size even.
+	 * The allocation bitmaps track PCPU_MIN_ALLOC_SIZE granules, so
+	 * that's the minimum alignment and size quantum we can serve.
 	 */
-	if (unlikely(align < 2))
-		align = 2;
+	if (unlikely(align < PCPU_MIN_ALLOC_SIZE))
+		align = PCPU_MIN_ALLOC_SIZE;
 
-	size = ALIGN(size, 2);
+	size = ALIGN(size, PCPU_MIN_ALLOC_SIZE);
 
 	if (unlikely(!size || size > PCPU_MIN_UNIT_SIZE || align > PAGE_SIZE)) {
 		WARN(true, "illegal size (%zu) or align (%zu) for percpu allocation\n",
@@ -906,16 +724,6 @@ static void __percpu *pcpu_alloc(size_t size, size_t align, bool reserved,
 			goto fail_unlock;
 		}
 
-		while ((new_alloc = pcpu_need_to_extend(chunk, is_atomic))) {
-			spin_unlock_irqrestore(&pcpu_lock, flags);
-			if (is_atomic ||
-			    pcpu_extend_area_map(chunk, new_alloc) < 0) {
-				err = "failed to extend area map of reserved chunk";
-				goto fail;
-			}
-			spin_lock_irqsave(&pcpu_lock, flags);
-		}
-
 		off = pcpu_alloc_area(chunk, size, align, is_atomic,
 				      &occ_pages);
 		if (off >= 0)
@@ -932,24 +740,6 @@ restart:
 			if (size > chunk->contig_hint)
 				continue;
 
-			new_alloc = pcpu_need_to_extend(chunk, is_atomic);
-			if (new_alloc) {
-				if (is_atomic)
-					continue;
-				spin_unlock_irqrestore(&pcpu_lock, flags);
-				if (pcpu_extend_area_map(chunk,
-							 new_alloc) < 0) {
-					err = "failed to extend area map";
-					goto fail;
-				}
-				spin_lock_irqsave(&pcpu_lock, flags);
-				/*
-				 * pcpu_lock has been dropped, need to
-				 * restart cpu_slot list walking.
-				 */
-				goto restart;
-			}
-
 			off = pcpu_alloc_area(chunk, size, align, is_atomic,
 					      &occ_pages);
 			if (off >= 0)
@@ -1124,7 +914,6 @@ static void pcpu_balance_workfn(struct work_struct *work)
 		if (chunk == list_first_entry(free_head, struct pcpu_chunk, list))
 			continue;
 
-		list_del_init(&chunk->map_extend_list);
 		list_move(&chunk->list, &to_free);
 	}
 
@@ -1142,25 +931,6 @@ static void pcpu_balance_workfn(struct work_struct *work)
 		pcpu_destroy_chunk(chunk);
 	}
 
-	/* service chunks which requested async area map extension */
-	do {
-		int new_alloc = 0;
-
-		spin_lock_irq(&pcpu_lock);
-
-		chunk = list_first_entry_or_null(&pcpu_map_extend_chunks,
-					struct pcpu_chunk, map_extend_list);
-		if (chunk) {
-			list_del_init(&chunk->map_extend_list);
-			new_alloc = pcpu_need_to_extend(chunk, false);
-		}
-
-		spin_unlock_irq(&pcpu_lock);
-
-		if (new_alloc)
-			pcpu_extend_area_map(chunk, new_alloc);
-	} while (chunk);
-
 	/*
 	 * Ensure there are certain number of free populated pages for
 	 * atomic allocs.  Fill up from the most packed so that atomic
@@ -1541,8 +1311,6 @@ static void pcpu_dump_alloc_info(const char *lvl,
 int __init pcpu_setup_first_chunk(const struct pcpu_alloc_info *ai,
 				  void *base_addr)
 {
-	static int smap[PERCPU_DYNAMIC_EARLY_SLOTS] __initdata;
-	static int dmap[PERCPU_DYNAMIC_EARLY_SLOTS] __initdata;
 	size_t dyn_size = ai->dyn_size;
 	size_t size_sum = ai->static_size + ai->reserved_size + dyn_size;
 	struct pcpu_chunk *schunk, *dchunk = NULL;
@@ -1551,7 +1319,7 @@ int __init pcpu_setup_first_chunk(const struct pcpu_alloc_info *ai,
 	unsigned long *unit_off;
 	unsigned int cpu;
 	int *unit_map;
-	int group, unit, i;
+	int group, unit, i, map_end;
 
 #define PCPU_SETUP_BUG_ON(cond)	do {					\
 	if (unlikely(cond)) {						\
@@ -1659,10 +1427,11 @@ int __init pcpu_setup_first_chunk(const struct pcpu_alloc_info *ai,
 	 */
 	schunk = memblock_virt_alloc(pcpu_chunk_struct_size, 0);
 	INIT_LIST_HEAD(&schunk->list);
-	INIT_LIST_HEAD(&schunk->map_extend_list);
 	schunk->base_addr = base_addr;
-	schunk->map = smap;
-	schunk->map_alloc = ARRAY_SIZE(smap);
+	schunk->alloc_map = memblock_virt_alloc(
+		BITS_TO_LONGS(pcpu_unit_map_bits()) * sizeof(unsigned long), 0);
+	schunk->bound_map = memblock_virt_alloc(
+		BITS_TO_LONGS(pcpu_unit_map_bits()) * sizeof(unsigned long), 0);
 	schunk->immutable = true;
 	bitmap_fill(schunk->populated, pcpu_unit_pages);
 	schunk->nr_populated = pcpu_unit_pages;
@@ -1677,36 +1446,60 @@ int __init pcpu_setup_first_chunk(const struct pcpu_alloc_info *ai,
 	}
 	schunk->contig_hint = schunk->free_size;
 
-	schunk->map[0] = 1;
-	schunk->map[1] = ai->static_size;
-	schunk->map_used = 1;
-	if (schunk->free_size)
-		schunk->map[++schunk->map_used] = ai->static_size + schunk->free_size;
-	schunk->map[schunk->map_used] |= 1;
+	/* the static area is never freed, mark it allocated */
+	bitmap_set(schunk->alloc_map, 0,
+		   ai->static_size >> PCPU_MIN_ALLOC_SHIFT);
+	set_bit(0, schunk->bound_map);
+	schunk->first_free = ai->static_size >> PCPU_MIN_ALLOC_SHIFT;
+
+	/* the tail beyond the served region is never handed out */
+	map_end = (ai->static_size + schunk->free_size) >> PCPU_MIN_ALLOC_SHIFT;
+	if (map_end < pcpu_unit_map_bits()) {
+		bitmap_set(schunk->alloc_map, map_end,
+			   pcpu_unit_map_bits() - map_end);
+		set_bit(map_end, schunk->bound_map);
+	}
 
 	/* init dynamic chunk if necessary */
 	if (dyn_size) {
 		dchunk = memblock_virt_alloc(pcpu_chunk_struct_size, 0);
 		INIT_LIST_HEAD(&dchunk->list);
-		INIT_LIST_HEAD(&dchunk->map_extend_list);
 		dchunk->base_addr = base_addr;
-		dchunk->map = dmap;
-		dchunk->map_alloc = ARRAY_SIZE(dmap);
+		dchunk->alloc_map = memblock_virt_alloc(
+			BITS_TO_LONGS(pcpu_unit_map_bits()) *
+			sizeof(unsigned long), 0);
+		dchunk->bound_map = memblock_virt_alloc(
+			BITS_TO_LONGS(pcpu_unit_map_bits()) *
+			sizeof(unsigned long), 0);
 		dchunk->immutable = true;
 		bitmap_fill(dchunk->populated, pcpu_unit_pages);
 		dchunk->nr_populated = pcpu_unit_pages;
 
 		dchunk->contig_hint = dchunk->free_size = dyn_size;
-		dchunk->map[0] = 1;
-		dchunk->map[1] = pcpu_reserved_chunk_limit;
-		dchunk->map[2] = (pcpu_reserved_chunk_limit + dchunk->free_size) | 1;
-		dchunk->map_used = 2;
+
+		/* static + reserved region is served by schunk */
+		bitmap_set(dchunk->alloc_map, 0,
+			   pcpu_reserved_chunk_limit >> PCPU_MIN_ALLOC_SHIFT);
+		set_bit(0, dchunk->bound_map);
+		dchunk->first_free =
+			pcpu_reserved_chunk_limit >> PCPU_MIN_ALLOC_SHIFT;
+
+		map_end = (pcpu_reserved_chunk_limit + dyn_size) >>
+			PCPU_MIN_ALLOC_SHIFT;
+		if (map_end < pcpu_unit_map_bits()) {
+			bitmap_set(dchunk->alloc_map, map_end,
+				   pcpu_unit_map_bits() - map_end);
+			set_bit(map_end, dchunk->bound_map);
+		}
 	}
 
 	/* link the first chunk in */
 	pcpu_first_chunk = dchunk ?: schunk;
 	pcpu_nr_empty_pop_pages +=
-		pcpu_count_occupied_pages(pcpu_first_chunk, 1);
+		pcpu_count_occupied_pages(pcpu_first_chunk,
+					  pcpu_first_chunk->first_free,
+					  pcpu_first_chunk->free_size >>
+					  PCPU_MIN_ALLOC_SHIFT);
 	pcpu_chunk_relocate(pcpu_first_chunk, -1);
 
 	/* we're done */
@@ -2265,35 +2058,6 @@ void __init setup_per_cpu_areas(void)
 
 #endif	/* CONFIG_SMP */
 
-/*
- * First and reserved chunks are initialized with temporary allocation
- * map in initdata so that they can be used before slab is online.
- * This function is called after slab is brought up and replaces those
- * with properly allocated maps.
- */
-void __init percpu_init_late(void)
-{
-	struct pcpu_chunk *target_chunks[] =
-		{ pcpu_first_chunk, pcpu_reserved_chunk, NULL };
-	struct pcpu_chunk *chunk;
-	unsigned long flags;
-	int i;
-
-	for (i = 0; (chunk = target_chunks[i]); i++) {
-		int *map;
-		const size_t size = PERCPU_DYNAMIC_EARLY_SLOTS * sizeof(map[0]);
-
-		BUILD_BUG_ON(size > PAGE_SIZE);
-
-		map = pcpu_mem_zalloc(size);
-		BUG_ON(!map);
-
-		spin_lock_irqsave(&pcpu_lock, flags);
-		memcpy(map, chunk->map, size);
-		chunk->map = map;
-		spin_unlock_irqrestore(&pcpu_lock, flags);
-	}
-}
 
 /*
  * Percpu allocator is initialized early during boot when neither slab or
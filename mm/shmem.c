@@ -1351,7 +1351,7 @@ static struct page *shmem_swapin(swp_entry_t swap, gfp_t gfp,
 	struct page *page;
 
 	shmem_pseudo_vma_init(&pvma, info, index);
-	page = swapin_readahead(swap, gfp, &pvma, 0);
+	page = swap_cluster_readahead(swap, gfp, &pvma, 0);
 	shmem_pseudo_vma_destroy(&pvma);
 
 	return page;
@@ -1595,7 +1595,7 @@ repeat:
 
 	if (swap.val) {
 		/* Look it up and read it in.. */
-		page = lookup_swap_cache(swap);
+		page = lookup_swap_cache(swap, NULL, 0);
 		if (!page) {
 			/* Or update major stats only when swapin succeeds?? */
 			if (fault_type) {
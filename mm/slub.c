@@ -2623,6 +2623,159 @@ static void *__slab_alloc(struct kmem_cache *s, gfp_t gfpflags, int node,
  *
  * Otherwise we can simply pick the next object from the lockless free list.
  */
+/*
+ * Optional per-cpu array in front of the regular freelists, for caches
+ * with bursty alloc/free patterns (see kmem_cache_setup_percpu_array()).
+ * Objects sitting in the array are, from the core allocator's point of
+ * view, allocated: they were obtained through kmem_cache_alloc_bulk()
+ * with all hooks applied, and are handed back the same way when the
+ * array is flushed.  An array hit is therefore just an irq-disabled
+ * push or pop of a pointer.
+ */
+struct kmem_cache_cpu_array {
+	unsigned int size;	/* capacity, set once at setup time */
+	unsigned int count;	/* objects currently cached */
+	void *objects[];
+};
+
+/* How many objects to move between an array and the freelists at once */
+#define CPU_ARRAY_BATCH	16
+
+static void *alloc_from_cpu_array(struct kmem_cache *s, gfp_t gfpflags)
+{
+	void *objects[CPU_ARRAY_BATCH];
+	struct kmem_cache_cpu_array *ca;
+	unsigned long flags;
+	void *object;
+	int refilled, moved;
+
+	local_irq_save(flags);
+	ca = this_cpu_ptr(s->cpu_array);
+	if (likely(ca->count)) {
+		object = ca->objects[--ca->count];
+		local_irq_restore(flags);
+		goto out;
+	}
+	local_irq_restore(flags);
+
+	/*
+	 * Refill through the regular bulk path, which must be entered
+	 * with interrupts enabled; from irq or irq-disabled context
+	 * fall back to the ordinary allocation path instead.
+	 */
+	if (irqs_disabled())
+		return NULL;
+
+	refilled = kmem_cache_alloc_bulk(s, gfpflags & ~__GFP_ZERO,
+					 CPU_ARRAY_BATCH, objects);
+	if (!refilled)
+		return NULL;
+
+	object = objects[--refilled];
+
+	local_irq_save(flags);
+	ca = this_cpu_ptr(s->cpu_array);
+	moved = min_t(int, refilled, ca->size - ca->count);
+	memcpy(ca->objects + ca->count, objects, moved * sizeof(void *));
+	ca->count += moved;
+	local_irq_restore(flags);
+
+	/* somebody else refilled the array meanwhile: give back the rest */
+	if (unlikely(moved < refilled))
+		kmem_cache_free_bulk(s, refilled - moved, objects + moved);
+out:
+	if (unlikely(gfpflags & __GFP_ZERO))
+		memset(object, 0, s->object_size);
+	return object;
+}
+
+static bool free_to_cpu_array(struct kmem_cache *s, void *x)
+{
+	void *objects[CPU_ARRAY_BATCH];
+	struct kmem_cache_cpu_array *ca;
+	unsigned long flags;
+	int batch = 0;
+
+	local_irq_save(flags);
+	ca = this_cpu_ptr(s->cpu_array);
+	if (unlikely(ca->count == ca->size)) {
+		batch = min_t(unsigned int, CPU_ARRAY_BATCH, ca->count);
+		ca->count -= batch;
+		memcpy(objects, ca->objects + ca->count,
+		       batch * sizeof(void *));
+	}
+	ca->objects[ca->count++] = x;
+	local_irq_restore(flags);
+
+	if (unlikely(batch))
+		kmem_cache_free_bulk(s, batch, objects);
+	return true;
+}
+
+/*
+ * Optional per-cpu queue batching frees of objects that belong to
+ * remote-node slabs (see kmem_cache_setup_remote_free()).  Each cpu
+ * owns two equally sized buffers: objects queue up in the active one,
+ * and when it fills the empty spare is swapped in so that the full
+ * buffer can be handed to kmem_cache_free_bulk() with interrupts
+ * enabled.  The detached-freelist logic there merges queued objects of
+ * the same slab into a single cmpxchg against the remote freelist,
+ * which is where the cross-node traffic saving comes from.
+ */
+struct kmem_cache_remote_free {
+	unsigned int size;	/* capacity of each buffer */
+	unsigned int count;	/* objects in the active buffer */
+	void **objects;		/* active buffer */
+	void **spare;		/* empty buffer, NULL while a flush runs */
+};
+
+static bool free_to_remote_queue(struct kmem_cache *s, void *x)
+{
+	struct kmem_cache_remote_free *rq;
+	unsigned long flags;
+	void **full = NULL;
+	unsigned int nr = 0;
+
+	if (likely(page_to_nid(virt_to_head_page(x)) == numa_node_id()))
+		return false;
+
+	preempt_disable();
+	local_irq_save(flags);
+	rq = this_cpu_ptr(s->remote_free);
+	if (unlikely(rq->count == rq->size)) {
+		if (unlikely(!rq->spare)) {
+			/*
+			 * An interrupt refilled the queue while the cpu
+			 * below us is flushing it: free this one object
+			 * the ordinary way.
+			 */
+			local_irq_restore(flags);
+			preempt_enable();
+			return false;
+		}
+		full = rq->objects;
+		nr = rq->count;
+		rq->objects = rq->spare;
+		rq->spare = NULL;
+		rq->count = 0;
+	}
+	rq->objects[rq->count++] = x;
+	local_irq_restore(flags);
+
+	if (unlikely(full)) {
+		/*
+		 * Preemption stays off so the buffer is returned to the
+		 * queue it was taken from.
+		 */
+		kmem_cache_free_bulk(s, nr, full);
+		local_irq_save(flags);
+		rq->spare = full;
+		local_irq_restore(flags);
+	}
+	preempt_enable();
+	return true;
+}
+
 static __always_inline void *slab_alloc_node(struct kmem_cache *s,
 		gfp_t gfpflags, int node, unsigned long addr)
 {
@@ -2634,6 +2787,12 @@ static __always_inline void *slab_alloc_node(struct kmem_cache *s,
 	s = slab_pre_alloc_hook(s, gfpflags);
 	if (!s)
 		return NULL;
+
+	if (unlikely(s->cpu_array) && node == NUMA_NO_NODE) {
+		object = alloc_from_cpu_array(s, gfpflags);
+		if (likely(object))
+			return object;
+	}
 redo:
 	/*
 	 * Must read kmem_cache cpu data via this cpu ptr. Preemption is
@@ -2970,6 +3129,14 @@ void kmem_cache_free(struct kmem_cache *s, void *x)
 	s = cache_from_obj(s, x);
 	if (!s)
 		return;
+	if (unlikely(s->remote_free) && free_to_remote_queue(s, x)) {
+		trace_kmem_cache_free(_RET_IP_, x);
+		return;
+	}
+	if (unlikely(s->cpu_array) && free_to_cpu_array(s, x)) {
+		trace_kmem_cache_free(_RET_IP_, x);
+		return;
+	}
 	slab_free(s, virt_to_head_page(x), x, NULL, 1, _RET_IP_);
 	trace_kmem_cache_free(_RET_IP_, x);
 }
@@ -3664,6 +3831,129 @@ static void free_partial(struct kmem_cache *s, struct kmem_cache_node *n)
 		discard_slab(s, page);
 }
 
+/**
+ * kmem_cache_setup_percpu_array - put a per-cpu array in front of @s
+ * @s: the cache, which must not have a constructor-visible lifetime
+ *     dependency on immediate freeing
+ * @count: per-cpu array capacity, in objects
+ *
+ * Once set up, kmem_cache_alloc() and kmem_cache_free() on @s serve
+ * bursts from a per-cpu LIFO of object pointers, falling back to (and
+ * refilling/flushing CPU_ARRAY_BATCH objects at a time through) the
+ * regular bulk paths.  Intended to be called right after the cache is
+ * created, before it sees any allocations.
+ */
+int kmem_cache_setup_percpu_array(struct kmem_cache *s, unsigned int count)
+{
+	struct kmem_cache_cpu_array __percpu *ca;
+	int cpu;
+
+	if (WARN_ON_ONCE(!count || s->cpu_array))
+		return -EINVAL;
+
+	ca = __alloc_percpu(sizeof(struct kmem_cache_cpu_array) +
+			    count * sizeof(void *),
+			    __alignof__(struct kmem_cache_cpu_array));
+	if (!ca)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		per_cpu_ptr(ca, cpu)->size = count;
+
+	s->cpu_array = ca;
+	return 0;
+}
+EXPORT_SYMBOL(kmem_cache_setup_percpu_array);
+
+/**
+ * kmem_cache_setup_remote_free - batch @s's frees to remote-node slabs
+ * @s: the cache
+ * @count: per-cpu queue depth, in objects
+ *
+ * Intended to be called right after the cache is created.  On a single
+ * node system this is a no-op.
+ */
+int kmem_cache_setup_remote_free(struct kmem_cache *s, unsigned int count)
+{
+	struct kmem_cache_remote_free __percpu *rf;
+	int cpu, failed_cpu;
+
+	if (WARN_ON_ONCE(!count || s->remote_free))
+		return -EINVAL;
+
+	if (nr_node_ids == 1)
+		return 0;
+
+	rf = alloc_percpu(struct kmem_cache_remote_free);
+	if (!rf)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_remote_free *rq = per_cpu_ptr(rf, cpu);
+
+		rq->objects = kmalloc_array(count, sizeof(void *), GFP_KERNEL);
+		rq->spare = kmalloc_array(count, sizeof(void *), GFP_KERNEL);
+		if (!rq->objects || !rq->spare)
+			goto error;
+		rq->size = count;
+	}
+
+	s->remote_free = rf;
+	return 0;
+
+error:
+	failed_cpu = cpu;
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_remote_free *rq = per_cpu_ptr(rf, cpu);
+
+		kfree(rq->objects);
+		kfree(rq->spare);
+		if (cpu == failed_cpu)
+			break;
+	}
+	free_percpu(rf);
+	return -ENOMEM;
+}
+EXPORT_SYMBOL(kmem_cache_setup_remote_free);
+
+static void free_remote_queues(struct kmem_cache *s)
+{
+	int cpu;
+
+	if (!s->remote_free)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_remote_free *rq =
+			per_cpu_ptr(s->remote_free, cpu);
+
+		if (rq->count)
+			kmem_cache_free_bulk(s, rq->count, rq->objects);
+		kfree(rq->objects);
+		kfree(rq->spare);
+	}
+	free_percpu(s->remote_free);
+	s->remote_free = NULL;
+}
+
+static void free_cpu_arrays(struct kmem_cache *s)
+{
+	int cpu;
+
+	if (!s->cpu_array)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		struct kmem_cache_cpu_array *ca = per_cpu_ptr(s->cpu_array, cpu);
+
+		if (ca->count)
+			kmem_cache_free_bulk(s, ca->count, ca->objects);
+		ca->count = 0;
+	}
+	free_percpu(s->cpu_array);
+	s->cpu_array = NULL;
+}
+
 /*
  * Release all resources used by a slab cache.
  */
@@ -3672,6 +3962,8 @@ int __kmem_cache_shutdown(struct kmem_cache *s)
 	int node;
 	struct kmem_cache_node *n;
 
+	free_remote_queues(s);
+	free_cpu_arrays(s);
 	flush_all(s);
 	/* Attempt to free all objects */
 	for_each_kmem_cache_node(s, node, n) {
@@ -288,6 +288,27 @@ void truncate_inode_pages_range(struct address_space *mapping,
 				unlock_page(page);
 				continue;
 			}
+			if (PageTransCompound(page)) {
+				struct page *head = compound_head(page);
+
+				/*
+				 * The only THPs the generic truncate path can
+				 * meet are the clean read-only ones built by
+				 * collapse_file(): drop the whole compound
+				 * page, even if the range covers it only
+				 * partially. The data can be re-read from
+				 * disk; leaving the page half-truncated would
+				 * trip over VM_BUG_ON_PAGE(PageTail) below.
+				 */
+				if (page_mapping(head) == mapping)
+					truncate_inode_page(mapping, head);
+				unlock_page(page);
+				if (PageHead(page)) {
+					index += HPAGE_PMD_NR - 1;
+					i += HPAGE_PMD_NR - 1;
+				}
+				continue;
+			}
 			truncate_inode_page(mapping, page);
 			unlock_page(page);
 		}
@@ -373,6 +394,19 @@ void truncate_inode_pages_range(struct address_space *mapping,
 			lock_page(page);
 			WARN_ON(page_to_index(page) != index);
 			wait_on_page_writeback(page);
+			if (PageTransCompound(page)) {
+				struct page *head = compound_head(page);
+
+				/* Drop the whole THP: see the first pass */
+				if (page_mapping(head) == mapping)
+					truncate_inode_page(mapping, head);
+				unlock_page(page);
+				if (PageHead(page)) {
+					index += HPAGE_PMD_NR - 1;
+					i += HPAGE_PMD_NR - 1;
+				}
+				continue;
+			}
 			truncate_inode_page(mapping, page);
 			unlock_page(page);
 		}
@@ -618,6 +652,14 @@ int invalidate_inode_pages2_range(struct address_space *mapping,
 				continue;
 			}
 			wait_on_page_writeback(page);
+			/* Middle of THP: the head does the whole page */
+			if (PageTransTail(page)) {
+				unlock_page(page);
+				continue;
+			} else if (PageTransHuge(page)) {
+				index += HPAGE_PMD_NR - 1;
+				i += HPAGE_PMD_NR - 1;
+			}
 			if (page_mapped(page)) {
 				if (!did_range_unmap) {
 					/*
@@ -634,8 +676,10 @@ int invalidate_inode_pages2_range(struct address_space *mapping,
 					 * Just zap this page
 					 */
 					unmap_mapping_range(mapping,
-					   (loff_t)index << PAGE_SHIFT,
-					   PAGE_SIZE, 0);
+					   (loff_t)page_to_index(page)
+							<< PAGE_SHIFT,
+					   PageTransHuge(page) ?
+						HPAGE_PMD_SIZE : PAGE_SIZE, 0);
 				}
 			}
 			BUG_ON(page_mapped(page));
@@ -23,6 +23,7 @@
 #include <linux/list.h>
 #include <linux/notifier.h>
 #include <linux/rbtree.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/radix-tree.h>
 #include <linux/rcupdate.h>
 #include <linux/pfn.h>
@@ -283,11 +284,17 @@ LIST_HEAD(vmap_area_list);
 static LLIST_HEAD(vmap_purge_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 
-/* The vmap cache globals are protected by vmap_area_lock */
-static struct rb_node *free_vmap_cache;
-static unsigned long cached_hole_size;
-static unsigned long cached_vstart;
-static unsigned long cached_align;
+/*
+ * Remember the last hole freed on this cpu; repeat allocations of the
+ * same size (BPF programs, vmap stacks, ...) typically refill exactly
+ * the hole that the previous instance vacated.  Only a hint: it is
+ * revalidated against the rbtree, under vmap_area_lock, before use.
+ */
+struct vmap_hole_hint {
+	unsigned long addr;
+	unsigned long size;
+};
+static DEFINE_PER_CPU(struct vmap_hole_hint, vmap_hole_hint);
 
 static unsigned long vmap_area_pcpu_hole;
 
@@ -310,11 +317,52 @@ static struct vmap_area *__find_vmap_area(unsigned long addr)
 	return NULL;
 }
 
+/* End address of the area preceding @va, or 0 if @va is the lowest */
+static unsigned long vmap_area_prev_end(struct vmap_area *va)
+{
+	if (va->list.prev == &vmap_area_list)
+		return 0;
+	return list_prev_entry(va, list)->va_end;
+}
+
+/*
+ * largest hole immediately below any area in @va's subtree, in the
+ * style of vma_compute_subtree_gap()
+ */
+static unsigned long vmap_area_compute_subtree_gap(struct vmap_area *va)
+{
+	unsigned long max, subtree_gap;
+
+	max = va->va_start - vmap_area_prev_end(va);
+	if (va->rb_node.rb_left) {
+		subtree_gap = rb_entry(va->rb_node.rb_left,
+				struct vmap_area, rb_node)->rb_subtree_gap;
+		if (subtree_gap > max)
+			max = subtree_gap;
+	}
+	if (va->rb_node.rb_right) {
+		subtree_gap = rb_entry(va->rb_node.rb_right,
+				struct vmap_area, rb_node)->rb_subtree_gap;
+		if (subtree_gap > max)
+			max = subtree_gap;
+	}
+	return max;
+}
+
+RB_DECLARE_CALLBACKS(static, vmap_area_gap_callbacks, struct vmap_area,
+		     rb_node, unsigned long, rb_subtree_gap,
+		     vmap_area_compute_subtree_gap)
+
+static void vmap_area_gap_update(struct vmap_area *va)
+{
+	vmap_area_gap_callbacks_propagate(&va->rb_node, NULL);
+}
+
 static void __insert_vmap_area(struct vmap_area *va)
 {
 	struct rb_node **p = &vmap_area_root.rb_node;
 	struct rb_node *parent = NULL;
-	struct rb_node *tmp;
+	struct vmap_area *prev = NULL;
 
 	while (*p) {
 		struct vmap_area *tmp_va;
@@ -323,29 +371,164 @@ static void __insert_vmap_area(struct vmap_area *va)
 		tmp_va = rb_entry(parent, struct vmap_area, rb_node);
 		if (va->va_start < tmp_va->va_end)
 			p = &(*p)->rb_left;
-		else if (va->va_end > tmp_va->va_start)
+		else if (va->va_end > tmp_va->va_start) {
+			prev = tmp_va;
 			p = &(*p)->rb_right;
-		else
+		} else
 			BUG();
 	}
 
-	rb_link_node(&va->rb_node, parent, p);
-	rb_insert_color(&va->rb_node, &vmap_area_root);
-
-	/* address-sort this list */
-	tmp = rb_prev(&va->rb_node);
-	if (tmp) {
-		struct vmap_area *prev;
-		prev = rb_entry(tmp, struct vmap_area, rb_node);
+	/*
+	 * Address-sort the list before touching the rbtree: the gap
+	 * callbacks compute each area's hole from its list neighbour.
+	 */
+	if (prev)
 		list_add_rcu(&va->list, &prev->list);
-	} else
+	else
 		list_add_rcu(&va->list, &vmap_area_list);
+
+	/* the new area shrinks the hole below its successor */
+	if (!list_is_last(&va->list, &vmap_area_list))
+		vmap_area_gap_update(list_next_entry(va, list));
+
+	va->rb_subtree_gap = 0;
+	rb_link_node(&va->rb_node, parent, p);
+	vmap_area_gap_update(va);
+	rb_insert_augmented(&va->rb_node, &vmap_area_root,
+			    &vmap_area_gap_callbacks);
 }
 
 static void purge_vmap_area_lazy(void);
 
 static BLOCKING_NOTIFIER_HEAD(vmap_notify_list);
 
+/* Is [addr, addr + size) free of vmap areas?  Called under vmap_area_lock. */
+static bool vmap_range_is_free(unsigned long addr, unsigned long size)
+{
+	struct rb_node *n = vmap_area_root.rb_node;
+	struct vmap_area *first = NULL;
+
+	while (n) {
+		struct vmap_area *tmp;
+
+		tmp = rb_entry(n, struct vmap_area, rb_node);
+		if (tmp->va_end > addr) {
+			first = tmp;
+			n = n->rb_left;
+		} else
+			n = n->rb_right;
+	}
+
+	return !first || first->va_start >= addr + size;
+}
+
+/*
+ * Find the lowest free hole in [vstart, vend) fitting @size bytes at
+ * @align, by descending the rb_subtree_gap augmented rbtree the same
+ * way unmapped_area() does.  Returns the address to allocate at, or
+ * @vend if no hole is large enough.  Called under vmap_area_lock.
+ */
+static unsigned long vmap_area_find_hole(unsigned long size,
+					 unsigned long align,
+					 unsigned long vstart,
+					 unsigned long vend)
+{
+	struct vmap_area *va;
+	unsigned long length, low_limit, high_limit, gap_start, gap_end;
+
+	/* Adjust search length to account for worst case alignment overhead */
+	length = size + align - 1;
+	if (length < size)
+		return vend;
+
+	/* Adjust search limits by the desired length */
+	if (vend < length)
+		return vend;
+	high_limit = vend - length;
+
+	if (vstart > high_limit)
+		return vend;
+	low_limit = vstart + length;
+
+	/* Check if rbtree root looks promising */
+	if (RB_EMPTY_ROOT(&vmap_area_root)) {
+		gap_start = 0;
+		goto check_highest;
+	}
+	va = rb_entry(vmap_area_root.rb_node, struct vmap_area, rb_node);
+	if (va->rb_subtree_gap < length)
+		goto check_last;
+
+	while (true) {
+		/* Visit left subtree if it looks promising */
+		gap_end = va->va_start;
+		if (gap_end >= low_limit && va->rb_node.rb_left) {
+			struct vmap_area *left =
+				rb_entry(va->rb_node.rb_left,
+					 struct vmap_area, rb_node);
+			if (left->rb_subtree_gap >= length) {
+				va = left;
+				continue;
+			}
+		}
+
+		gap_start = vmap_area_prev_end(va);
+check_current:
+		/* Check if current node has a suitable gap */
+		if (gap_start > high_limit)
+			return vend;
+		if (gap_end >= low_limit && gap_end - gap_start >= length)
+			goto found;
+
+		/* Visit right subtree if it looks promising */
+		if (va->rb_node.rb_right) {
+			struct vmap_area *right =
+				rb_entry(va->rb_node.rb_right,
+					 struct vmap_area, rb_node);
+			if (right->rb_subtree_gap >= length) {
+				va = right;
+				continue;
+			}
+		}
+
+		/* Go back up the rbtree to find next candidate node */
+		while (true) {
+			struct rb_node *prev = &va->rb_node;
+
+			if (!rb_parent(prev))
+				goto check_last;
+			va = rb_entry(rb_parent(prev),
+				      struct vmap_area, rb_node);
+			if (prev == va->rb_node.rb_left) {
+				gap_start = vmap_area_prev_end(va);
+				gap_end = va->va_start;
+				goto check_current;
+			}
+		}
+	}
+
+check_last:
+	gap_start = list_last_entry(&vmap_area_list,
+				    struct vmap_area, list)->va_end;
+check_highest:
+	/* Check highest gap, which does not precede any vmap area */
+	gap_end = ULONG_MAX;
+	if (gap_start > high_limit)
+		return vend;
+
+found:
+	/* We found a suitable gap. Clip it with the original low limit. */
+	if (gap_start < vstart)
+		gap_start = vstart;
+
+	/* Adjust gap address to the desired alignment */
+	gap_start = ALIGN(gap_start, align);
+
+	BUG_ON(gap_start + size > vend);
+	BUG_ON(gap_start + size > gap_end);
+	return gap_start;
+}
+
 /*
  * Allocate a region of KVA of the specified size and alignment, within the
  * vstart and vend.
@@ -355,11 +538,10 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 				unsigned long vstart, unsigned long vend,
 				int node, gfp_t gfp_mask)
 {
+	struct vmap_hole_hint *hint;
 	struct vmap_area *va;
-	struct rb_node *n;
 	unsigned long addr;
 	int purged = 0;
-	struct vmap_area *first;
 
 	BUG_ON(!size);
 	BUG_ON(offset_in_page(size));
@@ -380,75 +562,17 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 
 retry:
 	spin_lock(&vmap_area_lock);
-	/*
-	 * Invalidate cache if we have more permissive parameters.
-	 * cached_hole_size notes the largest hole noticed _below_
-	 * the vmap_area cached in free_vmap_cache: if size fits
-	 * into that hole, we want to scan from vstart to reuse
-	 * the hole instead of allocating above free_vmap_cache.
-	 * Note that __free_vmap_area may update free_vmap_cache
-	 * without updating cached_hole_size or cached_align.
-	 */
-	if (!free_vmap_cache ||
-			size < cached_hole_size ||
-			vstart < cached_vstart ||
-			align < cached_align) {
-nocache:
-		cached_hole_size = 0;
-		free_vmap_cache = NULL;
-	}
-	/* record if we encounter less permissive parameters */
-	cached_vstart = vstart;
-	cached_align = align;
-
-	/* find starting point for our search */
-	if (free_vmap_cache) {
-		first = rb_entry(free_vmap_cache, struct vmap_area, rb_node);
-		addr = ALIGN(first->va_end, align);
-		if (addr < vstart)
-			goto nocache;
-		if (addr + size < addr)
-			goto overflow;
-
-	} else {
-		addr = ALIGN(vstart, align);
-		if (addr + size < addr)
-			goto overflow;
-
-		n = vmap_area_root.rb_node;
-		first = NULL;
-
-		while (n) {
-			struct vmap_area *tmp;
-			tmp = rb_entry(n, struct vmap_area, rb_node);
-			if (tmp->va_end >= addr) {
-				first = tmp;
-				if (tmp->va_start <= addr)
-					break;
-				n = n->rb_left;
-			} else
-				n = n->rb_right;
-		}
-
-		if (!first)
-			goto found;
-	}
-
-	/* from the starting point, walk areas until a suitable hole is found */
-	while (addr + size > first->va_start && addr + size <= vend) {
-		if (addr + cached_hole_size < first->va_start)
-			cached_hole_size = first->va_start - addr;
-		addr = ALIGN(first->va_end, align);
-		if (addr + size < addr)
-			goto overflow;
 
-		if (list_is_last(&first->list, &vmap_area_list))
-			goto found;
-
-		first = list_next_entry(first, list);
-	}
+	/* try the hole vacated by the last free on this cpu first */
+	hint = this_cpu_ptr(&vmap_hole_hint);
+	addr = hint->addr;
+	if (hint->size == size && IS_ALIGNED(addr, align) &&
+	    addr >= vstart && addr + size <= vend &&
+	    vmap_range_is_free(addr, size))
+		hint->size = 0;
+	else
+		addr = vmap_area_find_hole(size, align, vstart, vend);
 
-found:
 	if (addr + size > vend)
 		goto overflow;
 
@@ -456,7 +580,6 @@ found:
 	va->va_end = addr + size;
 	va->flags = 0;
 	__insert_vmap_area(va);
-	free_vmap_cache = &va->rb_node;
 	spin_unlock(&vmap_area_lock);
 
 	BUG_ON(!IS_ALIGNED(va->va_start, align));
@@ -503,27 +626,27 @@ EXPORT_SYMBOL_GPL(unregister_vmap_purge_notifier);
 
 static void __free_vmap_area(struct vmap_area *va)
 {
+	struct vmap_hole_hint *hint;
+	struct vmap_area *next = NULL;
+
 	BUG_ON(RB_EMPTY_NODE(&va->rb_node));
 
-	if (free_vmap_cache) {
-		if (va->va_end < cached_vstart) {
-			free_vmap_cache = NULL;
-		} else {
-			struct vmap_area *cache;
-			cache = rb_entry(free_vmap_cache, struct vmap_area, rb_node);
-			if (va->va_start <= cache->va_start) {
-				free_vmap_cache = rb_prev(&va->rb_node);
-				/*
-				 * We don't try to update cached_hole_size or
-				 * cached_align, but it won't go very wrong.
-				 */
-			}
-		}
-	}
-	rb_erase(&va->rb_node, &vmap_area_root);
+	if (!list_is_last(&va->list, &vmap_area_list))
+		next = list_next_entry(va, list);
+
+	rb_erase_augmented(&va->rb_node, &vmap_area_root,
+			   &vmap_area_gap_callbacks);
 	RB_CLEAR_NODE(&va->rb_node);
 	list_del_rcu(&va->list);
 
+	/* the hole below the successor just grew */
+	if (next)
+		vmap_area_gap_update(next);
+
+	hint = this_cpu_ptr(&vmap_hole_hint);
+	hint->addr = va->va_start;
+	hint->size = va->va_end - va->va_start;
+
 	/*
 	 * Track the highest possible candidate for pcpu area
 	 * allocation.  Areas outside of vmalloc area can be returned
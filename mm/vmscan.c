@@ -35,6 +35,7 @@
 #include <linux/cpu.h>
 #include <linux/cpuset.h>
 #include <linux/compaction.h>
+#include <linux/migrate.h>
 #include <linux/notifier.h>
 #include <linux/rwsem.h>
 #include <linux/delay.h>
@@ -43,6 +44,7 @@
 #include <linux/memcontrol.h>
 #include <linux/delayacct.h>
 #include <linux/sysctl.h>
+#include <linux/psi.h>
 #include <linux/oom.h>
 #include <linux/prefetch.h>
 #include <linux/printk.h>
@@ -103,6 +105,9 @@ struct scan_control {
 	/* One of the zones is ready for compaction */
 	unsigned int compaction_ready:1;
 
+	/* Reclaim must free pages on this node, do not demote instead */
+	unsigned int no_demotion:1;
+
 	/* Incremented by the number of inactive pages that were scanned */
 	unsigned long nr_scanned;
 
@@ -810,12 +815,155 @@ enum page_references {
 	PAGEREF_ACTIVATE,
 };
 
+#ifdef CONFIG_PTABLE_AGING
+/*
+ * Page-table-walk based LRU aging.
+ *
+ * Instead of discovering references one page at a time through rmap
+ * walks in shrink_page_list(), periodically scan the page tables of
+ * registered mms in address order, clear the accessed bits and feed
+ * the results into mark_page_accessed().  Promotion through the
+ * referenced -> active tiers then happens in bulk with good locality,
+ * and for anonymous pages the reclaim path can trust the walk instead
+ * of doing a per-page rmap walk of its own.
+ */
+
+/* All user mms, rotated so each aging run resumes where the last left off */
+static LIST_HEAD(ptaging_mms);
+static DEFINE_SPINLOCK(ptaging_lock);
+
+/* Reclaim may rely on a walk no older than this */
+#define PTAGING_INTERVAL	(2 * HZ)
+/* Walk at most this many mms per kswapd wakeup */
+#define PTAGING_MMS_PER_RUN	8
+
+static unsigned long ptaging_valid_until;
+
+void ptaging_mm_add(struct mm_struct *mm)
+{
+	spin_lock(&ptaging_lock);
+	list_add_tail(&mm->aging_list, &ptaging_mms);
+	spin_unlock(&ptaging_lock);
+}
+
+void ptaging_mm_del(struct mm_struct *mm)
+{
+	spin_lock(&ptaging_lock);
+	list_del(&mm->aging_list);
+	spin_unlock(&ptaging_lock);
+}
+
+static int ptaging_pmd_entry(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct vm_area_struct *vma = walk->vma;
+	pte_t *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+
+	ptl = pmd_trans_huge_lock(pmd, vma);
+	if (ptl) {
+		if (pmd_young(*pmd)) {
+			pmdp_test_and_clear_young(vma, addr, pmd);
+			mark_page_accessed(pmd_page(*pmd));
+		}
+		spin_unlock(ptl);
+		return 0;
+	}
+
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+
+		if (!pte_present(ptent) || !pte_young(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		ptep_test_and_clear_young(vma, addr, pte);
+		mark_page_accessed(page);
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+	cond_resched();
+	return 0;
+}
+
+static void ptaging_walk_mm(struct mm_struct *mm)
+{
+	struct mm_walk walk = {
+		.pmd_entry = ptaging_pmd_entry,
+		.mm = mm,
+	};
+
+	if (!down_read_trylock(&mm->mmap_sem))
+		return;
+	walk_page_range(0, mm->highest_vm_end, &walk);
+	up_read(&mm->mmap_sem);
+}
+
+/*
+ * Age a bounded batch of mms.  Called from kswapd, at most once per
+ * PTAGING_INTERVAL; direct reclaim never pays for the walks.
+ */
+static void ptaging_run(void)
+{
+	static unsigned long next_run;
+	struct mm_struct *mm;
+	int batch = PTAGING_MMS_PER_RUN;
+
+	if (time_before(jiffies, READ_ONCE(next_run)))
+		return;
+	WRITE_ONCE(next_run, jiffies + PTAGING_INTERVAL);
+
+	spin_lock(&ptaging_lock);
+	while (batch-- && !list_empty(&ptaging_mms)) {
+		mm = list_first_entry(&ptaging_mms, struct mm_struct,
+				      aging_list);
+		list_move_tail(&mm->aging_list, &ptaging_mms);
+		if (!atomic_inc_not_zero(&mm->mm_users))
+			continue;
+		spin_unlock(&ptaging_lock);
+
+		ptaging_walk_mm(mm);
+		mmput(mm);
+
+		spin_lock(&ptaging_lock);
+	}
+	spin_unlock(&ptaging_lock);
+
+	WRITE_ONCE(ptaging_valid_until, jiffies + 2 * PTAGING_INTERVAL);
+}
+
+static bool ptaging_recent(void)
+{
+	return time_before(jiffies, READ_ONCE(ptaging_valid_until));
+}
+#else
+static inline void ptaging_run(void) { }
+static inline bool ptaging_recent(void) { return false; }
+#endif /* CONFIG_PTABLE_AGING */
+
 static enum page_references page_check_references(struct page *page,
 						  struct scan_control *sc)
 {
 	int referenced_ptes, referenced_page;
 	unsigned long vm_flags;
 
+	/*
+	 * If the aging walk swept the page tables recently, any
+	 * accessed bits an anonymous page accumulated have already
+	 * been folded into PG_referenced/PG_active; skip the rmap
+	 * walk and evict straight from the coldest tier.
+	 */
+	if (PageAnon(page) && !PageSwapCache(page) && ptaging_recent())
+		return TestClearPageReferenced(page) ?
+			PAGEREF_KEEP : PAGEREF_RECLAIM;
+
 	referenced_ptes = page_referenced(page, 1, sc->target_mem_cgroup,
 					  &vm_flags);
 	referenced_page = TestClearPageReferenced(page);
@@ -897,6 +1045,85 @@ static void page_check_dirty_writeback(struct page *page,
 /*
  * shrink_page_list() returns the number of reclaimed pages
  */
+static bool can_demote(int nid, struct scan_control *sc)
+{
+	if (!numa_demotion_enabled)
+		return false;
+	if (sc && sc->no_demotion)
+		return false;
+	if (next_demotion_node(nid) == NUMA_NO_NODE)
+		return false;
+
+	return true;
+}
+
+static struct page *alloc_demote_page(struct page *page, unsigned long node,
+				      int **result)
+{
+	/*
+	 * Fail quickly and quietly: demotion is an optimization, and
+	 * the page can still be reclaimed the normal way.  Kicking the
+	 * target node's kswapd is fine, entering direct reclaim from
+	 * reclaim is not.
+	 */
+	gfp_t gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_DIRECT_RECLAIM) |
+			 __GFP_THISNODE | __GFP_NOWARN | __GFP_NOMEMALLOC;
+
+	return __alloc_pages_node(node, gfp_mask, 0);
+}
+
+/*
+ * Take pages on @demote_list and attempt to demote them to
+ * another node.  Pages which are not demoted are left on
+ * @demote_pages.
+ */
+static unsigned long demote_page_list(struct list_head *demote_pages,
+				      struct pglist_data *pgdat)
+{
+	int target_nid = next_demotion_node(pgdat->node_id);
+	unsigned long nr_before = 0, nr_demoted;
+	struct page *page;
+	int err;
+
+	if (list_empty(demote_pages))
+		return 0;
+
+	if (target_nid == NUMA_NO_NODE)
+		return 0;
+
+	/*
+	 * Our caller accounts the whole batch against NR_ISOLATED when
+	 * it is put back, but migrate_pages() decrements it for every
+	 * page it takes off the list; balance that out up front, and
+	 * back out again below for the pages that are left behind.
+	 */
+	list_for_each_entry(page, demote_pages, lru) {
+		inc_node_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+		nr_before++;
+	}
+
+	/* Demotion ignores all cpuset and mempolicy settings */
+	err = migrate_pages(demote_pages, alloc_demote_page, NULL,
+			    target_nid, MIGRATE_ASYNC, MR_DEMOTION);
+
+	list_for_each_entry(page, demote_pages, lru)
+		dec_node_page_state(page, NR_ISOLATED_ANON +
+				    page_is_file_cache(page));
+
+	/*
+	 * migrate_pages() returns the number of pages it could not
+	 * migrate, or -ENOMEM if it gave up early; in the latter case
+	 * the successes cannot be told apart, so don't count any.
+	 */
+	nr_demoted = err < 0 ? 0 : nr_before - err;
+
+	mod_node_page_state(pgdat, current_is_kswapd() ?
+			    PGDEMOTE_KSWAPD : PGDEMOTE_DIRECT, nr_demoted);
+
+	return nr_demoted;
+}
+
 static unsigned long shrink_page_list(struct list_head *page_list,
 				      struct pglist_data *pgdat,
 				      struct scan_control *sc,
@@ -910,6 +1137,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 {
 	LIST_HEAD(ret_pages);
 	LIST_HEAD(free_pages);
+	LIST_HEAD(demote_pages);
 	int pgactivate = 0;
 	unsigned long nr_unqueued_dirty = 0;
 	unsigned long nr_dirty = 0;
@@ -917,9 +1145,12 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 	unsigned long nr_reclaimed = 0;
 	unsigned long nr_writeback = 0;
 	unsigned long nr_immediate = 0;
+	bool do_demote_pass;
 
 	cond_resched();
+	do_demote_pass = can_demote(pgdat->node_id, sc);
 
+retry:
 	while (!list_empty(page_list)) {
 		struct address_space *mapping;
 		struct page *page;
@@ -1061,6 +1292,16 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			; /* try to reclaim the page below */
 		}
 
+		/*
+		 * Before reclaiming the page, try to relocate
+		 * its contents to another node.
+		 */
+		if (do_demote_pass && !PageTransHuge(page)) {
+			list_add(&page->lru, &demote_pages);
+			unlock_page(page);
+			continue;
+		}
+
 		/*
 		 * Anonymous process memory has backing store?
 		 * Try to allocate it some swap space here.
@@ -1250,6 +1491,17 @@ keep:
 		list_add(&page->lru, &ret_pages);
 		VM_BUG_ON_PAGE(PageLRU(page) || PageUnevictable(page), page);
 	}
+	/* 'page_list' is always empty here */
+
+	/* Migrate pages selected for demotion */
+	nr_reclaimed += demote_page_list(&demote_pages, pgdat);
+	/* Pages that could not be demoted are still in @demote_pages */
+	if (!list_empty(&demote_pages)) {
+		/* Pages which failed to demote go back for normal reclaim */
+		list_splice_init(&demote_pages, page_list);
+		do_demote_pass = false;
+		goto retry;
+	}
 
 	mem_cgroup_uncharge_list(&free_pages);
 	try_to_unmap_flush();
@@ -1273,6 +1525,7 @@ unsigned long reclaim_clean_pages_from_list(struct zone *zone,
 		.gfp_mask = GFP_KERNEL,
 		.priority = DEF_PRIORITY,
 		.may_unmap = 1,
+		.no_demotion = 1,
 	};
 	unsigned long ret, dummy1, dummy2, dummy3, dummy4, dummy5;
 	struct page *page, *next;
@@ -1294,6 +1547,69 @@ unsigned long reclaim_clean_pages_from_list(struct zone *zone,
 	return ret;
 }
 
+/*
+ * reclaim_pages - try to reclaim a list of isolated pages
+ *
+ * Used by MADV_PAGEOUT to push out pages the caller declared cold.
+ * The pages are fed to shrink_page_list() in per-node batches with
+ * reference checks disabled; whatever survives is put back on the LRU.
+ */
+unsigned long reclaim_pages(struct list_head *page_list)
+{
+	struct scan_control sc = {
+		.gfp_mask = GFP_KERNEL,
+		.priority = DEF_PRIORITY,
+		.may_writepage = 1,
+		.may_unmap = 1,
+		.may_swap = 1,
+		.no_demotion = 1,
+	};
+	unsigned long nr_reclaimed = 0;
+	unsigned long dummy1, dummy2, dummy3, dummy4, dummy5;
+	LIST_HEAD(node_page_list);
+	struct page *page;
+	int nid = NUMA_NO_NODE;
+
+	while (!list_empty(page_list)) {
+		page = lru_to_page(page_list);
+		if (nid == NUMA_NO_NODE)
+			nid = page_to_nid(page);
+
+		if (nid == page_to_nid(page)) {
+			ClearPageActive(page);
+			list_move(&page->lru, &node_page_list);
+			continue;
+		}
+
+		nr_reclaimed += shrink_page_list(&node_page_list,
+				NODE_DATA(nid), &sc,
+				TTU_UNMAP|TTU_IGNORE_ACCESS,
+				&dummy1, &dummy2, &dummy3, &dummy4, &dummy5,
+				true);
+		while (!list_empty(&node_page_list)) {
+			page = lru_to_page(&node_page_list);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+		nid = NUMA_NO_NODE;
+	}
+
+	if (!list_empty(&node_page_list)) {
+		nr_reclaimed += shrink_page_list(&node_page_list,
+				NODE_DATA(nid), &sc,
+				TTU_UNMAP|TTU_IGNORE_ACCESS,
+				&dummy1, &dummy2, &dummy3, &dummy4, &dummy5,
+				true);
+		while (!list_empty(&node_page_list)) {
+			page = lru_to_page(&node_page_list);
+			list_del(&page->lru);
+			putback_lru_page(page);
+		}
+	}
+
+	return nr_reclaimed;
+}
+
 /*
  * Attempt to remove the specified page from its LRU.  Only take this page
  * if it is of the appropriate PageActive status.  Pages which are being
@@ -2939,6 +3255,7 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				gfp_t gfp_mask, nodemask_t *nodemask)
 {
 	unsigned long nr_reclaimed;
+	unsigned long pflags;
 	struct scan_control sc = {
 		.nr_to_reclaim = SWAP_CLUSTER_MAX,
 		.gfp_mask = (gfp_mask = memalloc_noio_flags(gfp_mask)),
@@ -2964,8 +3281,12 @@ unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 				gfp_mask,
 				sc.reclaim_idx);
 
+	psi_memstall_enter(&pflags);
+
 	nr_reclaimed = do_try_to_free_pages(zonelist, &sc);
 
+	psi_memstall_leave(&pflags);
+
 	trace_mm_vmscan_direct_reclaim_end(nr_reclaimed);
 
 	return nr_reclaimed;
@@ -3192,6 +3513,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 	int i;
 	unsigned long nr_soft_reclaimed;
 	unsigned long nr_soft_scanned;
+	unsigned long pflags;
 	struct zone *zone;
 	struct scan_control sc = {
 		.gfp_mask = GFP_KERNEL,
@@ -3201,8 +3523,11 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 		.may_unmap = 1,
 		.may_swap = 1,
 	};
+	psi_memstall_enter(&pflags);
 	count_vm_event(PAGEOUTRUN);
 
+	ptaging_run();
+
 	do {
 		bool raise_priority = true;
 
@@ -3301,6 +3626,7 @@ static int balance_pgdat(pg_data_t *pgdat, int order, int classzone_idx)
 	} while (sc.priority >= 1);
 
 out:
+	psi_memstall_leave(&pflags);
 	/*
 	 * Return the order kswapd stopped reclaiming at as
 	 * prepare_kswapd_sleep() takes it into account. If another caller
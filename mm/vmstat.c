@@ -886,6 +886,24 @@ static int __fragmentation_index(unsigned int order, struct contig_page_info *in
 	return 1000 - div_u64( (1000+(div_u64(info->free_pages * 1000ULL, requested))), info->free_blocks_total);
 }
 
+/*
+ * Calculates external fragmentation within a zone wrt the given order.
+ * It is defined as the percentage of pages found in blocks of size
+ * less than 1 << order. It returns values in range [0, 100].
+ */
+unsigned int extfrag_for_order(struct zone *zone, unsigned int order)
+{
+	struct contig_page_info info;
+
+	fill_contig_page_info(zone, order, &info);
+	if (info.free_pages == 0)
+		return 0;
+
+	return div_u64((info.free_pages -
+			(info.free_blocks_suitable << order)) * 100,
+			info.free_pages);
+}
+
 /* Same as __fragmentation index but allocs contig_page_info on stack */
 int fragmentation_index(struct zone *zone, unsigned int order)
 {
@@ -967,12 +985,16 @@ const char * const vmstat_text[] = {
 	"nr_shmem",
 	"nr_shmem_hugepages",
 	"nr_shmem_pmdmapped",
+	"nr_file_hugepages",
+	"nr_file_pmdmapped",
 	"nr_anon_transparent_hugepages",
 	"nr_unstable",
 	"nr_vmscan_write",
 	"nr_vmscan_immediate_reclaim",
 	"nr_dirtied",
 	"nr_written",
+	"pgdemote_kswapd",
+	"pgdemote_direct",
 
 	/* enum writeback_stat_item counters */
 	"nr_dirty_threshold",
@@ -1087,6 +1109,10 @@ const char * const vmstat_text[] = {
 	"vmacache_find_hits",
 	"vmacache_full_flushes",
 #endif
+#ifdef CONFIG_SWAP
+	"swap_ra",
+	"swap_ra_hit",
+#endif
 #endif /* CONFIG_VM_EVENTS_COUNTERS */
 };
 #endif /* CONFIG_PROC_FS || CONFIG_SYSFS || CONFIG_NUMA */
@@ -1432,6 +1458,8 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 static int zoneinfo_show(struct seq_file *m, void *arg)
 {
 	pg_data_t *pgdat = (pg_data_t *)arg;
+
+	vmstat_sync();
 	walk_zones_in_node(m, pgdat, zoneinfo_show_print);
 	return 0;
 }
@@ -1469,6 +1497,8 @@ static void *vmstat_start(struct seq_file *m, loff_t *pos)
 
 	if (*pos >= ARRAY_SIZE(vmstat_text))
 		return NULL;
+
+	vmstat_sync();
 	stat_items_size = NR_VM_ZONE_STAT_ITEMS * sizeof(unsigned long) +
 			  NR_VM_NODE_STAT_ITEMS * sizeof(unsigned long) +
 			  NR_VM_WRITEBACK_STAT_ITEMS * sizeof(unsigned long);
@@ -1549,8 +1579,22 @@ static const struct file_operations proc_vmstat_file_operations = {
 #ifdef CONFIG_SMP
 static struct workqueue_struct *vmstat_wq;
 static DEFINE_PER_CPU(struct delayed_work, vmstat_work);
+static DEFINE_PER_CPU(struct work_struct, vmstat_sync_work);
 int sysctl_stat_interval __read_mostly = HZ;
 
+/*
+ * When set, the periodic folding of per-cpu differentials into the
+ * global counters is switched off and readers that need global
+ * accuracy fold the outstanding differentials via vmstat_sync()
+ * instead.  The drift of each global counter is still bounded by the
+ * per-cpu stat thresholds, and allocator watermark checks near the
+ * danger zone go through zone_watermark_ok_safe(), which sums the
+ * differentials itself; so the only effect of leaving diffs unfolded
+ * is slightly stale statistics, in exchange for no periodic wakeups
+ * on otherwise idle cpus.
+ */
+int sysctl_stat_ondemand __read_mostly = 1;
+
 #ifdef CONFIG_PROC_FS
 static void refresh_vm_stats(struct work_struct *work)
 {
@@ -1612,7 +1656,7 @@ int vmstat_refresh(struct ctl_table *table, int write,
 
 static void vmstat_update(struct work_struct *w)
 {
-	if (refresh_cpu_vm_stats(true)) {
+	if (refresh_cpu_vm_stats(true) && !sysctl_stat_ondemand) {
 		/*
 		 * Counters were updated so we expect more updates
 		 * to occur in the future. Keep on running the
@@ -1652,6 +1696,34 @@ static bool need_update(int cpu)
 	return false;
 }
 
+static void vmstat_sync_workfn(struct work_struct *work)
+{
+	refresh_cpu_vm_stats(false);
+}
+
+/*
+ * Fold the outstanding per-cpu differentials of all online cpus into
+ * the global counters, on behalf of a reader who needs them accurate.
+ * Only cpus that actually have differentials are disturbed.  Does
+ * nothing unless periodic folding is switched off via stat_ondemand.
+ */
+void vmstat_sync(void)
+{
+	int cpu;
+
+	if (!sysctl_stat_ondemand)
+		return;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu)
+		if (need_update(cpu))
+			queue_work_on(cpu, vmstat_wq,
+				      &per_cpu(vmstat_sync_work, cpu));
+	for_each_online_cpu(cpu)
+		flush_work(&per_cpu(vmstat_sync_work, cpu));
+	put_online_cpus();
+}
+
 /*
  * Switch off vmstat processing and then fold all the remaining differentials
  * until the diffs stay at zero. The function is used by NOHZ and can only be
@@ -1693,11 +1765,13 @@ static void vmstat_shepherd(struct work_struct *w)
 
 	get_online_cpus();
 	/* Check processors whose vmstat worker threads have been disabled */
-	for_each_online_cpu(cpu) {
-		struct delayed_work *dw = &per_cpu(vmstat_work, cpu);
+	if (!sysctl_stat_ondemand) {
+		for_each_online_cpu(cpu) {
+			struct delayed_work *dw = &per_cpu(vmstat_work, cpu);
 
-		if (!delayed_work_pending(dw) && need_update(cpu))
-			queue_delayed_work_on(cpu, vmstat_wq, dw, 0);
+			if (!delayed_work_pending(dw) && need_update(cpu))
+				queue_delayed_work_on(cpu, vmstat_wq, dw, 0);
+		}
 	}
 	put_online_cpus();
 
@@ -1709,9 +1783,12 @@ static void __init start_shepherd_timer(void)
 {
 	int cpu;
 
-	for_each_possible_cpu(cpu)
+	for_each_possible_cpu(cpu) {
 		INIT_DEFERRABLE_WORK(per_cpu_ptr(&vmstat_work, cpu),
 			vmstat_update);
+		INIT_WORK(per_cpu_ptr(&vmstat_sync_work, cpu),
+			vmstat_sync_workfn);
+	}
 
 	vmstat_wq = alloc_workqueue("vmstat", WQ_FREEZABLE|WQ_MEM_RECLAIM, 0);
 	schedule_delayed_work(&shepherd,
@@ -0,0 +1,249 @@
+/*
+ * page_pool.c
+ *	Generic recycling allocator for DMA-mapped RX pages.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/dma-mapping.h>
+#include <linux/page-flags.h>
+
+#include <net/page_pool.h>
+
+/* Retry interval while waiting for in-flight pages on destroy */
+#define PP_RELEASE_RETRY	(HZ)
+
+static void page_pool_set_owner(struct page_pool *pool, struct page *page)
+{
+	page->lru.next = (void *)PP_SIGNATURE;
+	page->lru.prev = (void *)pool;
+}
+
+static void page_pool_clear_owner(struct page *page)
+{
+	page->lru.next = LIST_POISON1;
+	page->lru.prev = LIST_POISON2;
+}
+
+static bool page_pool_owns(struct page *page)
+{
+	return page->lru.next == (void *)PP_SIGNATURE;
+}
+
+static struct page *__page_pool_alloc_page(struct page_pool *pool, gfp_t gfp)
+{
+	struct page *page;
+	dma_addr_t dma;
+
+	page = alloc_pages_node(pool->p.nid, gfp, pool->p.order);
+	if (!page)
+		return NULL;
+
+	if (pool->p.flags & PP_FLAG_DMA_MAP) {
+		dma = dma_map_page(pool->p.dev, page, 0,
+				   PAGE_SIZE << pool->p.order,
+				   pool->p.dma_dir);
+		if (dma_mapping_error(pool->p.dev, dma)) {
+			put_page(page);
+			return NULL;
+		}
+		set_page_private(page, (unsigned long)dma);
+	}
+
+	page_pool_set_owner(pool, page);
+	return page;
+}
+
+/*
+ * Refill the lockless cache from the ring.  NAPI context only.
+ */
+static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
+{
+	struct page *page;
+
+	do {
+		page = ptr_ring_consume(&pool->ring);
+		if (!page)
+			break;
+		pool->alloc.cache[pool->alloc.count++] = page;
+	} while (pool->alloc.count < PP_ALLOC_CACHE_REFILL);
+
+	if (!pool->alloc.count)
+		return NULL;
+	return pool->alloc.cache[--pool->alloc.count];
+}
+
+/*
+ * Fast-path allocation.  Must be called from the pool's NAPI/softirq
+ * context; the alloc cache is deliberately unlocked.
+ */
+struct page *page_pool_alloc_pages(struct page_pool *pool, gfp_t gfp)
+{
+	struct page *page;
+
+	if (likely(pool->alloc.count))
+		page = pool->alloc.cache[--pool->alloc.count];
+	else
+		page = page_pool_refill_alloc_cache(pool);
+
+	if (!page)
+		page = __page_pool_alloc_page(pool, gfp);
+
+	if (page)
+		atomic_inc(&pool->pages_in_flight);
+	return page;
+}
+EXPORT_SYMBOL(page_pool_alloc_pages);
+
+void page_pool_release_page(struct page_pool *pool, struct page *page)
+{
+	if (pool->p.flags & PP_FLAG_DMA_MAP) {
+		dma_unmap_page(pool->p.dev, page_pool_get_dma_addr(page),
+			       PAGE_SIZE << pool->p.order, pool->p.dma_dir);
+		set_page_private(page, 0);
+	}
+	page_pool_clear_owner(page);
+}
+EXPORT_SYMBOL(page_pool_release_page);
+
+static void page_pool_return_page(struct page_pool *pool, struct page *page)
+{
+	page_pool_release_page(pool, page);
+	put_page(page);
+}
+
+void page_pool_put_page(struct page_pool *pool, struct page *page,
+			bool allow_direct)
+{
+	/*
+	 * A recyclable page must be exclusively owned; shared pages go
+	 * back through the page allocator like any other.
+	 */
+	if (unlikely(page_ref_count(page) != 1 ||
+		     page_is_pfmemalloc(page) ||
+		     pool->destroyed))
+		goto release;
+
+	if (allow_direct && pool->alloc.count < PP_ALLOC_CACHE_SIZE) {
+		pool->alloc.cache[pool->alloc.count++] = page;
+		atomic_dec(&pool->pages_in_flight);
+		return;
+	}
+
+	if (ptr_ring_produce(&pool->ring, page) == 0) {
+		atomic_dec(&pool->pages_in_flight);
+		return;
+	}
+
+release:
+	page_pool_return_page(pool, page);
+	atomic_dec(&pool->pages_in_flight);
+}
+EXPORT_SYMBOL(page_pool_put_page);
+
+/*
+ * Hook for the skb freeing path: recycle an exclusively held frag
+ * page into its originating pool instead of freeing it.  Returns
+ * false if the page is not pool-owned (caller does put_page()).
+ */
+bool page_pool_return_skb_page(struct page *page)
+{
+	struct page_pool *pool;
+
+	page = compound_head(page);
+	if (!page_pool_owns(page))
+		return false;
+
+	pool = (struct page_pool *)page->lru.prev;
+	/*
+	 * skbs are freed from arbitrary contexts: never target the
+	 * NAPI-only cache from here.
+	 */
+	page_pool_put_page(pool, page, false);
+	return true;
+}
+EXPORT_SYMBOL(page_pool_return_skb_page);
+
+struct page_pool *page_pool_create(const struct page_pool_params *params)
+{
+	struct page_pool *pool;
+
+	if (params->flags & ~PP_FLAG_ALL)
+		return ERR_PTR(-EINVAL);
+
+	/* DMA addresses are stashed in page->private */
+	if ((params->flags & PP_FLAG_DMA_MAP) &&
+	    (!params->dev ||
+	     sizeof(dma_addr_t) > sizeof(unsigned long)))
+		return ERR_PTR(-EINVAL);
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+
+	pool->p = *params;
+	if (ptr_ring_init(&pool->ring, params->pool_size, GFP_KERNEL) < 0) {
+		kfree(pool);
+		return ERR_PTR(-ENOMEM);
+	}
+	atomic_set(&pool->pages_in_flight, 0);
+
+	return pool;
+}
+EXPORT_SYMBOL(page_pool_create);
+
+static void page_pool_empty_caches(struct page_pool *pool)
+{
+	struct page *page;
+
+	while (pool->alloc.count)
+		page_pool_return_page(pool,
+				pool->alloc.cache[--pool->alloc.count]);
+
+	while ((page = ptr_ring_consume(&pool->ring)))
+		page_pool_return_page(pool, page);
+}
+
+static void page_pool_release_retry(struct work_struct *wq)
+{
+	struct delayed_work *dwq = to_delayed_work(wq);
+	struct page_pool *pool = container_of(dwq, typeof(*pool), release_dw);
+
+	/* Returns that raced the destroy may have landed in the ring */
+	page_pool_empty_caches(pool);
+
+	if (atomic_read(&pool->pages_in_flight)) {
+		schedule_delayed_work(&pool->release_dw, PP_RELEASE_RETRY);
+		return;
+	}
+
+	ptr_ring_cleanup(&pool->ring, NULL);
+	kfree(pool);
+}
+
+/*
+ * Shut the pool down.  The caller must guarantee no new allocations;
+ * the pool itself lingers until every in-flight page has come back
+ * through page_pool_put_page() or the skb hook.
+ */
+void page_pool_destroy(struct page_pool *pool)
+{
+	pool->destroyed = true;
+	page_pool_empty_caches(pool);
+
+	INIT_DELAYED_WORK(&pool->release_dw, page_pool_release_retry);
+	if (atomic_read(&pool->pages_in_flight)) {
+		schedule_delayed_work(&pool->release_dw, PP_RELEASE_RETRY);
+		return;
+	}
+
+	ptr_ring_cleanup(&pool->ring, NULL);
+	kfree(pool);
+}
+EXPORT_SYMBOL(page_pool_destroy);
@@ -3463,6 +3463,14 @@ void __init skb_init(void)
 						0,
 						SLAB_HWCACHE_ALIGN|SLAB_PANIC,
 						NULL);
+	/*
+	 * Rx processing allocates skbs on the device's node while the
+	 * consuming application frees them from wherever it runs.
+	 * Batch those remote-node frees per cpu so the detached
+	 * freelist pass can merge them into one cmpxchg per slab.
+	 * Best effort: frees take the ordinary path if this fails.
+	 */
+	kmem_cache_setup_remote_free(skbuff_head_cache, 64);
 }
 
 /**
@@ -0,0 +1,98 @@
+#!/bin/bash
+# Test the cgroup2 memory.reclaim interface: malformed input is
+# rejected, reclaiming part of a page-cache-filled group lowers
+# memory.current, and an impossible target fails with EAGAIN once
+# the retries are exhausted.
+
+KSFT_SKIP=4
+
+if [ "$(id -u)" -ne 0 ]; then
+	echo "must be run as root, skipping"
+	exit $KSFT_SKIP
+fi
+
+# use an existing cgroup2 hierarchy or mount a private one
+CGROOT=$(awk '$3 == "cgroup2" {print $2; exit}' /proc/mounts)
+if [ -z "$CGROOT" ]; then
+	CGROOT=$(mktemp -d)
+	if ! mount -t cgroup2 none "$CGROOT" 2>/dev/null; then
+		echo "cgroup2 not available, skipping"
+		rmdir "$CGROOT"
+		exit $KSFT_SKIP
+	fi
+	UNMOUNT=1
+fi
+
+CG=$CGROOT/memcg_reclaim_test
+
+cleanup()
+{
+	echo $$ > "$CGROOT/cgroup.procs" 2>/dev/null
+	rmdir "$CG" 2>/dev/null
+	rm -f "$TMPFILE"
+	if [ -n "$UNMOUNT" ]; then
+		umount "$CGROOT"
+		rmdir "$CGROOT"
+	fi
+}
+trap cleanup EXIT
+
+if ! grep -qw memory "$CGROOT/cgroup.controllers"; then
+	echo "memory controller not available on cgroup2, skipping"
+	exit $KSFT_SKIP
+fi
+echo +memory > "$CGROOT/cgroup.subtree_control" 2>/dev/null
+
+mkdir "$CG" || exit 1
+if [ ! -f "$CG/memory.reclaim" ]; then
+	echo "memory.reclaim interface missing"
+	exit 1
+fi
+
+echo $$ > "$CG/cgroup.procs"
+
+# fill the group with page cache
+TMPFILE=$(mktemp)
+dd if=/dev/zero of="$TMPFILE" bs=1M count=32 2>/dev/null
+cat "$TMPFILE" > /dev/null
+
+exitcode=0
+
+before=$(cat "$CG/memory.current")
+if [ "$before" -lt $((16 * 1024 * 1024)) ]; then
+	echo "charged less than expected ($before bytes), skipping"
+	exit $KSFT_SKIP
+fi
+
+# malformed input must be rejected, not treated as a zero target
+if echo garbage > "$CG/memory.reclaim" 2>/dev/null; then
+	echo "[FAIL] malformed input accepted"
+	exitcode=1
+else
+	echo "[PASS] malformed input rejected"
+fi
+
+if echo 8M > "$CG/memory.reclaim"; then
+	echo "[PASS] reclaimed 8M"
+else
+	echo "[FAIL] could not reclaim 8M"
+	exitcode=1
+fi
+
+after=$(cat "$CG/memory.current")
+if [ "$after" -lt "$before" ]; then
+	echo "[PASS] memory.current dropped ($before -> $after)"
+else
+	echo "[FAIL] memory.current did not drop ($before -> $after)"
+	exitcode=1
+fi
+
+# far more than the group can give back: reclaim must give up (EAGAIN)
+if echo 1T > "$CG/memory.reclaim" 2>/dev/null; then
+	echo "[FAIL] impossible target reported success"
+	exitcode=1
+else
+	echo "[PASS] impossible target fails"
+fi
+
+exit $exitcode
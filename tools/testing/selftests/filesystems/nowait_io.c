@@ -0,0 +1,124 @@
+/*
+ * Exercise the RWF_NOWAIT flag of preadv2/pwritev2: unknown flag bits
+ * and buffered-IO use are rejected with -EOPNOTSUPP, and a direct read
+ * of a range with cached pages fails with -EAGAIN instead of blocking
+ * on writeback.  The direct-IO checks are skipped on filesystems that
+ * do not support O_DIRECT or do not advertise FMODE_NOWAIT.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#ifndef __NR_preadv2
+# if defined(__x86_64__)
+#  define __NR_preadv2	327
+#  define __NR_pwritev2	328
+# else
+#  define __NR_preadv2	286
+#  define __NR_pwritev2	287
+# endif
+#endif
+
+#ifndef RWF_NOWAIT
+#define RWF_NOWAIT	0x00000008
+#endif
+
+#define TESTFILE	"nowait_io_testfile"
+#define BUFSZ		4096
+
+static int nr_fail;
+
+static void check(int ok, const char *what)
+{
+	printf("%s: %s\n", ok ? "[PASS]" : "[FAIL]", what);
+	if (!ok)
+		nr_fail++;
+}
+
+static long sys_preadv2(int fd, const struct iovec *iov, int vlen,
+			off_t pos, int flags)
+{
+	return syscall(__NR_preadv2, fd, iov, vlen,
+		       (unsigned long)pos, 0UL, flags);
+}
+
+static long sys_pwritev2(int fd, const struct iovec *iov, int vlen,
+			 off_t pos, int flags)
+{
+	return syscall(__NR_pwritev2, fd, iov, vlen,
+		       (unsigned long)pos, 0UL, flags);
+}
+
+int main(void)
+{
+	struct iovec iov;
+	void *buf;
+	long ret;
+	int fd, dfd;
+
+	if (posix_memalign(&buf, BUFSZ, BUFSZ)) {
+		perror("posix_memalign");
+		return 1;
+	}
+	memset(buf, 'x', BUFSZ);
+	iov.iov_base = buf;
+	iov.iov_len = BUFSZ;
+
+	fd = open(TESTFILE, O_CREAT | O_TRUNC | O_RDWR, 0600);
+	if (fd < 0) {
+		perror("open");
+		return 1;
+	}
+
+	ret = sys_preadv2(fd, &iov, 1, 0, 0x80000000);
+	if (ret == -1 && errno == ENOSYS) {
+		printf("preadv2 not supported\n");
+		return 4;
+	}
+	check(ret == -1 && errno == EOPNOTSUPP,
+	      "unknown flag bit gets EOPNOTSUPP");
+
+	/* only direct IO can promise not to block on cached data */
+	ret = sys_pwritev2(fd, &iov, 1, 0, RWF_NOWAIT);
+	check(ret == -1 && errno == EOPNOTSUPP,
+	      "buffered RWF_NOWAIT gets EOPNOTSUPP");
+
+	/* populate the page cache over the first block */
+	if (pwrite(fd, buf, BUFSZ, 0) != BUFSZ) {
+		perror("pwrite");
+		return 1;
+	}
+
+	dfd = open(TESTFILE, O_RDWR | O_DIRECT);
+	if (dfd < 0) {
+		printf("O_DIRECT not supported here, skipping direct checks\n");
+		goto out;
+	}
+
+	ret = sys_preadv2(dfd, &iov, 1, 0, RWF_NOWAIT);
+	if (ret == -1 && errno == EOPNOTSUPP) {
+		printf("filesystem lacks FMODE_NOWAIT, skipping direct checks\n");
+		goto out;
+	}
+	check(ret == -1 && errno == EAGAIN,
+	      "direct RWF_NOWAIT read of cached range gets EAGAIN");
+
+	/* once the cache is clean and dropped the same read must go through */
+	fsync(fd);
+	posix_fadvise(fd, 0, BUFSZ, POSIX_FADV_DONTNEED);
+	ret = sys_preadv2(dfd, &iov, 1, 0, RWF_NOWAIT);
+	check(ret == BUFSZ || (ret == -1 && errno == EAGAIN),
+	      "direct RWF_NOWAIT read of clean range completes or EAGAINs");
+
+	close(dfd);
+out:
+	close(fd);
+	unlink(TESTFILE);
+	return nr_fail ? 1 : 0;
+}
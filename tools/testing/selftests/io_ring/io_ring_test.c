@@ -0,0 +1,157 @@
+/*
+ * Exercise the /dev/io_ring interface: setup parameter validation,
+ * ring mmap, NOP/READ submission and completion, and the per-sqe
+ * error reporting (-EINVAL cqes plus the dropped counter, -EBADF).
+ * Skips when the device is not present (CONFIG_IO_RING=n).
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <linux/io_ring.h>
+
+#define SQ_WANTED	4
+
+static int nr_fail;
+
+static void check(int ok, const char *what)
+{
+	printf("%s: %s\n", ok ? "[PASS]" : "[FAIL]", what);
+	if (!ok)
+		nr_fail++;
+}
+
+static void check_err(int ret, int err, const char *what)
+{
+	check(ret == -1 && errno == err, what);
+}
+
+static struct io_ring_sq *sq;
+static struct io_ring_cq *cq;
+static struct io_ring_sqe *sqes;
+
+static void submit_sqe(const struct io_ring_sqe *sqe)
+{
+	sqes[sq->tail & sq->ring_mask] = *sqe;
+	__sync_synchronize();
+	sq->tail++;
+}
+
+/* submit everything published and wait for one completion */
+static struct io_ring_cqe *wait_cqe(int fd)
+{
+	struct io_ring_enter e = {
+		.to_submit	= SQ_WANTED,
+		.min_complete	= 1,
+	};
+	struct io_ring_cqe *cqe;
+
+	if (ioctl(fd, IO_RING_IOC_ENTER, &e) < 0)
+		return NULL;
+	if (cq->tail == cq->head)
+		return NULL;
+	__sync_synchronize();
+	cqe = &cq->cqes[cq->head & cq->ring_mask];
+	cq->head++;
+	return cqe;
+}
+
+int main(void)
+{
+	struct io_ring_params p = { .sq_entries = SQ_WANTED };
+	struct io_ring_enter e = { .to_submit = 1 };
+	struct io_ring_params bad;
+	struct io_ring_sqe sqe;
+	struct io_ring_cqe *cqe;
+	char buf[64];
+	int fd, pipefd[2];
+
+	fd = open("/dev/io_ring", O_RDWR);
+	if (fd < 0) {
+		printf("/dev/io_ring not available\n");
+		return 4;
+	}
+
+	check_err(ioctl(fd, IO_RING_IOC_ENTER, &e), ENXIO,
+		  "enter before setup gets ENXIO");
+
+	memset(&bad, 0, sizeof(bad));
+	bad.sq_entries = SQ_WANTED;
+	bad.flags = 1;
+	check_err(ioctl(fd, IO_RING_IOC_SETUP, &bad), EINVAL,
+		  "setup with unknown flags gets EINVAL");
+	memset(&bad, 0, sizeof(bad));
+	check_err(ioctl(fd, IO_RING_IOC_SETUP, &bad), EINVAL,
+		  "setup with zero sq_entries gets EINVAL");
+
+	check(ioctl(fd, IO_RING_IOC_SETUP, &p) == 0, "setup");
+	check(p.cq_entries == 2 * p.sq_entries, "cq is twice the sq");
+	check_err(ioctl(fd, IO_RING_IOC_SETUP, &p), EBUSY,
+		  "second setup gets EBUSY");
+
+	sq = mmap(NULL, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+		  fd, IO_RING_OFF_SQ_RING);
+	cq = mmap(NULL, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+		  fd, IO_RING_OFF_CQ_RING);
+	sqes = mmap(NULL, getpagesize(), PROT_READ | PROT_WRITE, MAP_SHARED,
+		    fd, IO_RING_OFF_SQES);
+	if (sq == MAP_FAILED || cq == MAP_FAILED || sqes == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	check(sq->ring_entries == p.sq_entries &&
+	      cq->ring_entries == p.cq_entries, "mapped ring geometry");
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IO_RING_OP_NOP;
+	sqe.user_data = 0x11;
+	submit_sqe(&sqe);
+	cqe = wait_cqe(fd);
+	check(cqe && cqe->user_data == 0x11 && cqe->res == 0,
+	      "NOP completes with res 0");
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IO_RING_OP_LAST;
+	sqe.user_data = 0x22;
+	submit_sqe(&sqe);
+	cqe = wait_cqe(fd);
+	check(cqe && cqe->user_data == 0x22 && cqe->res == -EINVAL,
+	      "bad opcode completes with -EINVAL");
+	check(sq->dropped == 1, "bad opcode counted in sq->dropped");
+
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IO_RING_OP_READ;
+	sqe.fd = -1;
+	sqe.user_data = 0x33;
+	submit_sqe(&sqe);
+	cqe = wait_cqe(fd);
+	check(cqe && cqe->user_data == 0x33 && cqe->res == -EBADF,
+	      "bad fd completes with -EBADF");
+
+	if (pipe(pipefd)) {
+		perror("pipe");
+		return 1;
+	}
+	if (write(pipefd[1], "hello", 5) != 5) {
+		perror("write");
+		return 1;
+	}
+	memset(&sqe, 0, sizeof(sqe));
+	sqe.opcode = IO_RING_OP_READ;
+	sqe.fd = pipefd[0];
+	sqe.addr = (unsigned long)buf;
+	sqe.len = sizeof(buf);
+	sqe.user_data = 0x44;
+	submit_sqe(&sqe);
+	cqe = wait_cqe(fd);
+	check(cqe && cqe->user_data == 0x44 && cqe->res == 5 &&
+	      !memcmp(buf, "hello", 5), "pipe read completes with the data");
+
+	close(fd);
+	return nr_fail ? 1 : 0;
+}
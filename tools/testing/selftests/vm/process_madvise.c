@@ -0,0 +1,118 @@
+/*
+ * Exercise process_madvise(2) and the MADV_COLD/MADV_PAGEOUT hints it
+ * is restricted to: plain madvise() with the new hints, the remote
+ * success path against a forked child, and the -EINVAL/-ESRCH error
+ * paths.  The -EPERM check only runs without CAP_SYS_NICE, so it is
+ * skipped when the test runs as root.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#ifndef __NR_process_madvise
+#define __NR_process_madvise 291
+#endif
+
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+#define NR_PAGES 32
+
+static int nr_fail;
+
+static long sys_process_madvise(pid_t pid, const struct iovec *vec,
+				size_t vlen, int behavior, unsigned int flags)
+{
+	return syscall(__NR_process_madvise, pid, vec, vlen, behavior, flags);
+}
+
+static void check(int ok, const char *what)
+{
+	printf("%s: %s\n", ok ? "[PASS]" : "[FAIL]", what);
+	if (!ok)
+		nr_fail++;
+}
+
+static void check_err(long ret, int err, const char *what)
+{
+	check(ret == -1 && errno == err, what);
+}
+
+int main(void)
+{
+	size_t len = NR_PAGES * getpagesize();
+	struct iovec vec;
+	pid_t child;
+	char *map;
+	long ret;
+	int i;
+
+	map = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	for (i = 0; i < NR_PAGES; i++)
+		map[i * getpagesize()] = i;
+
+	check(madvise(map, len, MADV_COLD) == 0, "madvise(MADV_COLD)");
+	check(madvise(map, len, MADV_PAGEOUT) == 0, "madvise(MADV_PAGEOUT)");
+
+	vec.iov_base = map;
+	vec.iov_len = len;
+
+	ret = sys_process_madvise(getpid(), &vec, 1, MADV_COLD, 0);
+	if (ret == -1 && errno == ENOSYS) {
+		printf("process_madvise() not supported\n");
+		return 4;
+	}
+	check(ret == (long)len, "process_madvise(self, MADV_COLD)");
+
+	check_err(sys_process_madvise(getpid(), &vec, 1, MADV_DONTNEED, 0),
+		  EINVAL, "destructive hint rejected with EINVAL");
+	check_err(sys_process_madvise(getpid(), &vec, 1, MADV_COLD, 1),
+		  EINVAL, "nonzero flags rejected with EINVAL");
+
+	child = fork();
+	if (child == 0) {
+		pause();
+		_exit(0);
+	}
+	if (child < 0) {
+		perror("fork");
+		return 1;
+	}
+
+	/*
+	 * The child inherited the mapping at the same address; reclaim
+	 * hints on another process need ptrace access and CAP_SYS_NICE.
+	 */
+	ret = sys_process_madvise(child, &vec, 1, MADV_PAGEOUT, 0);
+	if (geteuid() == 0)
+		check(ret == (long)len, "process_madvise(child, MADV_PAGEOUT)");
+	else
+		check_err(ret, EPERM,
+			  "remote hint without CAP_SYS_NICE gets EPERM");
+
+	kill(child, SIGKILL);
+	waitpid(child, NULL, 0);
+
+	check_err(sys_process_madvise(child, &vec, 1, MADV_COLD, 0),
+		  ESRCH, "reaped pid gets ESRCH");
+
+	munmap(map, len);
+	return nr_fail ? 1 : 0;
+}